@@ -0,0 +1,38 @@
+# Embeds all shaders into a C++ source file
+# Usage: cmake -DSHADER_DIR=<dir> -DOUTPUT=<file> -P embedshaders.cmake
+# Includes stay unresolved, ShaderPreprocessor expands them from the embedded table so #line still maps to files.
+
+file(GLOB SHADER_FILES RELATIVE ${SHADER_DIR} ${SHADER_DIR}/*.vert ${SHADER_DIR}/*.frag ${SHADER_DIR}/*.geom ${SHADER_DIR}/*.glsl)
+list(SORT SHADER_FILES) # EmbeddedShaders::find uses a binary search
+
+set(CONTENT "// Generated by cmake/embedshaders.cmake, do not edit\n")
+string(APPEND CONTENT "#include \"framework/gl/embeddedshaders.hpp\"\n\n")
+string(APPEND CONTENT "#include <algorithm>\n#include <iterator>\n\n")
+string(APPEND CONTENT "namespace EmbeddedShaders {\n\n")
+string(APPEND CONTENT "static constexpr Entry ENTRIES[] = {\n")
+
+foreach(SHADER_FILE IN LISTS SHADER_FILES)
+    file(READ ${SHADER_DIR}/${SHADER_FILE} SOURCE)
+    string(FIND "${SOURCE}" ")glsl\"" DELIMITER)
+    if(NOT DELIMITER EQUAL -1)
+        message(FATAL_ERROR "${SHADER_FILE} contains the raw string delimiter )glsl\"")
+    endif()
+    string(APPEND CONTENT "    {\"${SHADER_FILE}\", R\"glsl(${SOURCE})glsl\"},\n")
+endforeach()
+
+string(APPEND CONTENT "};\n\n")
+string(APPEND CONTENT "const Entry* begin() { return std::begin(ENTRIES); }\n")
+string(APPEND CONTENT "const Entry* end() { return std::end(ENTRIES); }\n\n")
+string(APPEND CONTENT "const Entry* find(std::string_view name) {\n")
+string(APPEND CONTENT "    const Entry* it = std::lower_bound(begin(), end(), name, [](const Entry& entry, std::string_view name) { return entry.name < name; });\n")
+string(APPEND CONTENT "    return it != end() && it->name == name ? it : nullptr;\n")
+string(APPEND CONTENT "}\n\n")
+string(APPEND CONTENT "} // namespace EmbeddedShaders\n")
+
+# Only touch the output when something changed to avoid needless recompiles
+if(EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} PREVIOUS)
+endif()
+if(NOT "${PREVIOUS}" STREQUAL "${CONTENT}")
+    file(WRITE ${OUTPUT} "${CONTENT}")
+endif()
\ No newline at end of file
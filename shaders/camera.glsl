@@ -0,0 +1,5 @@
+// Camera uniforms shared by all programs, see CameraBlock in renderer/uniformblocks.hpp
+layout (std140) uniform CameraBlock {
+	mat4 uWorldToClip;
+	vec3 uCamPos;
+};
\ No newline at end of file
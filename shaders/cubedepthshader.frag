@@ -1,12 +1,11 @@
 #version 330 core
 
-in vec4 sFragPos;
+#include "lights.glsl"
 
-uniform vec3 uLightPosition;
-uniform float uFar;
+in vec4 sFragPos;
 
 void main() {
-	float distanceToLight = length(sFragPos.xyz - uLightPosition);
+	float distanceToLight = length(sFragPos.xyz - uShadowLightPos);
 
 	// map to range [0, 1]
 	distanceToLight = distanceToLight / uFar;
@@ -1,9 +1,14 @@
 #version 330 core
 
+#include "instancing.glsl"
+
 layout (location = 0) in vec3 inPosition;
 
-uniform mat4 uLocalToWorld;
+uniform mat4 uShadowTransform;
+
+out vec4 sFragPos;
 
 void main() {
-	gl_Position = uLocalToWorld * vec4(inPosition, 1.0);
+	sFragPos = LOCAL_TO_WORLD * vec4(inPosition, 1.0);
+	gl_Position = uShadowTransform * sFragPos;
 }
\ No newline at end of file
@@ -1,22 +1,13 @@
 #version 330 core
 
-#define NR_POINT_LIGHTS 5
+// Variant defines, injected by ProgramVariants:
+// DIR_LIGHT, ENABLE_DSHADOWS, ENABLE_OSHADOWS and NR_POINT_LIGHTS (at most MAX_POINT_LIGHTS)
+#ifndef NR_POINT_LIGHTS
+#define NR_POINT_LIGHTS 0
+#endif
 
-struct DirLight {
-	vec3 direction; // points toward light source, normalized
-	vec3 color;
-};
-
-struct PointLight {
-	vec3 position;
-	vec3 color;
-
-	float radius;
-
-	float constant;
-	float linear;
-	float quadratic;
-};
+#include "camera.glsl"
+#include "lights.glsl"
 
 vec3 sampleOffsetDirections[20] = vec3[]
 (
@@ -39,15 +30,6 @@ uniform sampler2D uAlbedoSpec;
 uniform sampler2D uDShadowMap;
 uniform samplerCube uOShadowMap;
 
-uniform DirLight uDirLight;
-uniform PointLight uPointLights[NR_POINT_LIGHTS];
-uniform vec3 uShadowLightPos;
-uniform float uFar;
-uniform vec3 uCamPos;
-uniform mat4 uLightSpaceMatrix;
-uniform bool uEnableDShadows;
-uniform bool uEnableOShadows;
-
 float dShadowCalculation(vec4 lightSpaceFragPos, float bias) {
 	vec3 projCoords = lightSpaceFragPos.xyz / lightSpaceFragPos.w;
 
@@ -143,9 +125,12 @@ void main() {
 
 	vec3 result = vec3(0.0);
 
+#ifdef DIR_LIGHT
 	// add directional light
 	result += calcDirLight(uDirLight, viewDir, normal, albedo, specular);
+#endif
 
+#if NR_POINT_LIGHTS > 0
 	// add point lights
 	for (int i = 0; i < NR_POINT_LIGHTS; i++) {
 		float dist = length(uPointLights[i].position - fragPos);
@@ -154,20 +139,21 @@ void main() {
 			result += calcPointLight(uPointLights[i], viewDir, normal, fragPos, albedo, specular, dist);
 		}
 	}
+#endif
 
 	// shadow casting
 	float shadow = 0.0;
 
-	if (uEnableDShadows) {
-		float dBias = max(0.05 * (1.0 - dot(normal, uDirLight.direction)), 0.005);
-		vec4 lightSpaceFragPos = uLightSpaceMatrix * vec4(fragPos, 1.0);
+#ifdef ENABLE_DSHADOWS
+	float dBias = max(0.05 * (1.0 - dot(normal, uDirLight.direction)), 0.005);
+	vec4 lightSpaceFragPos = uLightSpaceMatrix * vec4(fragPos, 1.0);
 
-		shadow += 0.5 * dShadowCalculation(lightSpaceFragPos, dBias);
-	}
+	shadow += 0.5 * dShadowCalculation(lightSpaceFragPos, dBias);
+#endif
 
-	if (uEnableOShadows) {
-		shadow += 0.5 * oShadowCalculation(fragPos);
-	}
+#ifdef ENABLE_OSHADOWS
+	shadow += 0.5 * oShadowCalculation(fragPos);
+#endif
 
 	result = (1 - shadow) * result;
 
@@ -1,10 +1,10 @@
 #version 330 core
 
-layout (location = 0) in vec3 inPosition;
+#include "lights.glsl"
+#include "instancing.glsl"
 
-uniform mat4 uLightSpaceMatrix;
-uniform mat4 uLocalToWorld;
+layout (location = 0) in vec3 inPosition;
 
 void main () {
-	gl_Position = uLightSpaceMatrix * uLocalToWorld * vec4(inPosition, 1.0);
+	gl_Position = uLightSpaceMatrix * LOCAL_TO_WORLD * vec4(inPosition, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,45 @@
+#version 330 core
+
+#include "camera.glsl"
+
+in vec3 sLocalPosition;
+in vec2 sTexCoord;
+
+layout (location = 0) out vec3 outPosition;
+layout (location = 1) out vec3 outNormal;
+layout (location = 2) out vec4 outAlbedoSpec;
+
+uniform sampler2D uAlbedoAtlas;
+uniform sampler2D uNormalAtlas;
+uniform sampler2D uDepthAtlas;
+
+uniform mat4 uLocalToWorld = mat4(1.0);
+uniform mat3 uNormalMatrix = mat3(1.0);
+
+uniform float uRadius;
+uniform vec3 uFrameDirection;
+uniform ivec2 uFrame;
+uniform int uFrames;
+
+void main() {
+	vec2 atlasCoord = (vec2(uFrame) + sTexCoord) / float(uFrames);
+
+	vec4 albedo = texture(uAlbedoAtlas, atlasCoord);
+
+	if (albedo.a < 0.5) {
+		discard;
+	}
+
+	vec3 normal = texture(uNormalAtlas, atlasCoord).xyz * 2.0 - 1.0;
+	float depth = texture(uDepthAtlas, atlasCoord).r;
+
+	// move the fragment from the quad onto the baked surface
+	vec4 worldPosition = uLocalToWorld * vec4(sLocalPosition + uFrameDirection * depth * uRadius, 1.0);
+	vec4 clipPosition = uWorldToClip * worldPosition;
+
+	gl_FragDepth = 0.5 * (clipPosition.z / clipPosition.w) + 0.5;
+
+	outPosition = worldPosition.xyz;
+	outNormal = normalize(uNormalMatrix * normal);
+	outAlbedoSpec = vec4(albedo.rgb, 0.0);
+}
\ No newline at end of file
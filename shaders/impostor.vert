@@ -0,0 +1,24 @@
+#version 330 core
+
+#include "camera.glsl"
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec2 inTexCoord;
+
+out vec3 sLocalPosition;
+out vec2 sTexCoord;
+
+uniform mat4 uLocalToWorld = mat4(1.0);
+
+uniform vec3 uCenter;
+uniform float uRadius;
+uniform vec3 uFrameRight;
+uniform vec3 uFrameUp;
+
+void main() {
+	// span the quad in the plane of the selected atlas frame
+	sLocalPosition = uCenter + (inPosition.x * uFrameRight + inPosition.y * uFrameUp) * uRadius;
+	sTexCoord = inTexCoord;
+
+	gl_Position = uWorldToClip * uLocalToWorld * vec4(sLocalPosition, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+// Object transform, per instance when compiled with INSTANCED, see Mesh::Instance in framework/mesh.hpp
+#ifdef INSTANCED
+layout (location = 8) in mat4 inLocalToWorld;
+layout (location = 12) in mat3 inNormalMatrix;
+
+#define LOCAL_TO_WORLD inLocalToWorld
+#define NORMAL_MATRIX inNormalMatrix
+#else
+uniform mat4 uLocalToWorld = mat4(1.0);
+uniform mat3 uNormalMatrix = mat3(1.0);
+
+#define LOCAL_TO_WORLD uLocalToWorld
+#define NORMAL_MATRIX uNormalMatrix
+#endif
\ No newline at end of file
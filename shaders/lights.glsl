@@ -0,0 +1,26 @@
+// Scene lights shared by the shadow and lighting passes, see LightBlock in renderer/uniformblocks.hpp
+#define MAX_POINT_LIGHTS 5
+
+struct DirLight {
+	vec3 direction; // points toward light source, normalized
+	vec3 color;
+};
+
+struct PointLight {
+	vec3 position;
+	vec3 color;
+
+	float radius;
+
+	float constant;
+	float linear;
+	float quadratic;
+};
+
+layout (std140) uniform LightBlock {
+	DirLight uDirLight;
+	PointLight uPointLights[MAX_POINT_LIGHTS];
+	mat4 uLightSpaceMatrix;
+	vec3 uShadowLightPos; // point light casting the omnidirectional shadow
+	float uFar;
+};
\ No newline at end of file
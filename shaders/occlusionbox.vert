@@ -0,0 +1,12 @@
+#version 330 core
+
+// unit cube, stretched over the bounds of the queried object
+layout (location = 0) in vec3 inPosition;
+
+uniform mat4 uToClip;
+uniform vec3 uMin;
+uniform vec3 uMax;
+
+void main() {
+	gl_Position = uToClip * vec4(mix(uMin, uMax, inPosition), 1.0);
+}
\ No newline at end of file
@@ -1,5 +1,8 @@
 #version 330 core
 
+#include "camera.glsl"
+#include "instancing.glsl"
+
 layout (location = 0) in vec3 inPosition;
 layout (location = 1) in vec2 inTexCoord;
 layout (location = 2) in vec3 inNormal;
@@ -10,18 +13,14 @@ out vec2 sTexCoord;
 out vec3 sNormal;
 out mat3 sTBN;
 
-uniform mat4 uLocalToWorld = mat4(1.0);
-uniform mat4 uWorldToClip = mat4(1.0);
-uniform mat3 uNormalMatrix = mat3(1.0);
-
 void main() {
-	gl_Position = uWorldToClip * uLocalToWorld * vec4(inPosition, 1.0);
+	gl_Position = uWorldToClip * LOCAL_TO_WORLD * vec4(inPosition, 1.0);
 
-	sPosition = vec3(uLocalToWorld * vec4(inPosition, 1.0));
+	sPosition = vec3(LOCAL_TO_WORLD * vec4(inPosition, 1.0));
 	sTexCoord = inTexCoord;
-	sNormal = uNormalMatrix * inNormal;
+	sNormal = NORMAL_MATRIX * inNormal;
 
-	vec3 tangent = normalize(uNormalMatrix * inTangent);
+	vec3 tangent = normalize(NORMAL_MATRIX * inTangent);
 	vec3 bitangent = normalize(cross(tangent, sNormal));
 
 	sTBN = mat3(tangent, bitangent, sNormal);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "framework/frustum.hpp"
+
 #include <glm/glm.hpp>
 
 class MovingCamera {
@@ -8,6 +10,8 @@ public:
 
 	const glm::mat4& view() const { return m_View; }
 	const glm::mat4& projection() const { return m_Projection; }
+	// world space planes of the current view
+	Frustum frustum() const { return Frustum(m_Projection * m_View); }
 
 	const glm::vec3& getPosition() const { return m_Position; }
 	const glm::vec3& getDirection() const { return m_Direction; }
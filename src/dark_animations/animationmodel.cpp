@@ -10,8 +10,8 @@ AnimationModel::AnimationModel(const std::string &path) {
 void AnimationModel::draw(Program &program) {
     program.bind();
 
-    for (const auto& meshName : m_Meshes) {
-        ResourceManager::getMesh(meshName).draw();
+    for (const auto& mesh : m_Meshes) {
+        ResourceManager::getMesh(mesh.getHandle()).draw();
     }
 }
 
@@ -35,7 +35,7 @@ void AnimationModel::processNode(aiNode* node, const aiScene* scene) {
     for (uint32_t i = 0; i < node->mNumMeshes; i++) {
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
 
-        m_Meshes.push_back(processMesh(mesh, scene));
+        m_Meshes.push_back(ResourceManager::acquire(processMesh(mesh, scene)));
     }
 
     // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
@@ -44,7 +44,7 @@ void AnimationModel::processNode(aiNode* node, const aiScene* scene) {
     }
 }
 
-std::string AnimationModel::processMesh(aiMesh* mesh, const aiScene* scene) {
+Handle<Mesh> AnimationModel::processMesh(aiMesh* mesh, const aiScene* scene) {
     std::vector<Mesh::VertexPCNTB> vertices;
     std::vector<uint32_t> indices;
 
@@ -79,15 +79,14 @@ std::string AnimationModel::processMesh(aiMesh* mesh, const aiScene* scene) {
     //aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 
     extractBoneWeightForVertices(vertices, mesh, scene);
+    expandBoneBounds(vertices);
 
     Mesh meshObj;
     meshObj.load(vertices, indices);
 
     std::string id = mesh->mName.C_Str();
 
-    ResourceManager::addMesh(std::move(meshObj), id);
-
-    return id;
+    return ResourceManager::addMesh(std::move(meshObj), id);
 }
 
 void AnimationModel::extractBoneWeightForVertices(std::vector<Mesh::VertexPCNTB> &vertices, aiMesh *mesh, const aiScene *scene) {
@@ -125,6 +124,44 @@ void AnimationModel::extractBoneWeightForVertices(std::vector<Mesh::VertexPCNTB>
     }
 }
 
+void AnimationModel::expandBoneBounds(const std::vector<Mesh::VertexPCNTB>& vertices) {
+    m_BoneBounds.resize(m_BoneCounter);
+
+    for (const Mesh::VertexPCNTB& vertex : vertices) {
+        float weightSum = 0.0f;
+
+        for (int i = 0; i < 4; i++) {
+            if (vertex.boneIDs[i] < 0 || vertex.weights[i] <= 0.0f) continue;
+
+            m_BoneBounds[vertex.boneIDs[i]].expand(vertex.position);
+            weightSum += vertex.weights[i];
+        }
+
+        if (weightSum < 0.999f) m_PartiallyWeighted = true;
+    }
+}
+
+Bounds AnimationModel::getBounds(const std::vector<glm::mat4>& boneMatrices) const {
+    // a skinned vertex is a weighted average of its bone transforms, so it lies inside the union of the
+    // transformed bone boxes, or between them and the origin if its weights don't add up to 1
+    Bounds bounds;
+
+    if (m_PartiallyWeighted) {
+        bounds.expand(glm::vec3(0.0f));
+    }
+
+    for (size_t i = 0; i < m_BoneBounds.size(); i++) {
+        // bones outside of the palette are drawn untransformed, see assimpshader.vert
+        if (i < boneMatrices.size()) {
+            bounds.expand(m_BoneBounds[i].transformed(boneMatrices[i]));
+        } else {
+            bounds.expand(m_BoneBounds[i]);
+        }
+    }
+
+    return bounds;
+}
+
 void AnimationModel::setVertexBoneDataToDefault(Mesh::VertexPCNTB& vertex) const {
     for (int i = 0; i < 4; i++) {
         vertex.boneIDs[i] = -1;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "registry.hpp"
+#include "framework/bounds.hpp"
 #include "framework/mesh.hpp"
 #include "framework/gl/program.hpp"
 
@@ -33,19 +35,28 @@ public:
     std::map<std::string, BoneInfo>& getBoneInfoMap() { return m_BoneInfoMap; }
     int& getBoneCount() { return m_BoneCounter; }
 
+    // conservative box around the model skinned with the given bone matrices, an empty palette gives the bind pose
+    Bounds getBounds(const std::vector<glm::mat4>& boneMatrices) const;
+
 private:
     void loadModel(const std::string& path);
 
     void processNode(aiNode* node, const aiScene* scene);
-    std::string processMesh(aiMesh* mesh, const aiScene* scene);
+    Handle<Mesh> processMesh(aiMesh* mesh, const aiScene* scene);
 
     void extractBoneWeightForVertices(std::vector<Mesh::VertexPCNTB>& vertices, aiMesh* mesh, const aiScene* scene);
+    void expandBoneBounds(const std::vector<Mesh::VertexPCNTB>& vertices);
 
     void setVertexBoneDataToDefault(Mesh::VertexPCNTB& vertex) const;
     void setVertexBoneData(Mesh::VertexPCNTB& vertex, int boneID, float weight) const;
 
 private:
-    std::vector<std::string> m_Meshes;
+    std::vector<AssetRef<Mesh>> m_Meshes;
     std::map<std::string, BoneInfo> m_BoneInfoMap;
     int m_BoneCounter = 0;
+
+    // bind pose box of the vertices every bone influences, indexed by bone id
+    std::vector<Bounds> m_BoneBounds;
+    // vertices with weights below 1 are pulled toward the origin
+    bool m_PartiallyWeighted = false;
 };
@@ -7,9 +7,9 @@ Animator::Animator()
 }
 
 Animator::Animator(Animation* animation) {
-    m_CurrentAnimation = animation;
+    m_CurrentAnimation = nullptr;
     m_CurrentTime = 0.0f;
-    m_FinalBoneMatrices.resize(100, glm::mat4(1.0f));
+    playAnimation(animation);
 }
 
 void Animator::update(float dt) {
@@ -24,6 +24,11 @@ void Animator::update(float dt) {
 void Animator::playAnimation(Animation* animation) {
     m_CurrentAnimation = animation;
     m_CurrentTime = 0.0f;
+
+    // one matrix per bone of the rig, the last pose is kept while no animation plays
+    if (animation) {
+        m_FinalBoneMatrices.assign(animation->getBoneIDMap().size(), glm::mat4(1.0f));
+    }
 }
 
 void Animator::calculateBoneTransform(const AssimpNodeData* node, const glm::mat4& parentTransform) {
@@ -46,7 +51,9 @@ void Animator::calculateBoneTransform(const AssimpNodeData* node, const glm::mat
         const int index = boneInfoMap.at(nodeName).id;
         const glm::mat4& offset = boneInfoMap.at(nodeName).offset;
 
-        m_FinalBoneMatrices[index] = globalTransformation * offset;
+        if (index >= 0 && index < static_cast<int>(m_FinalBoneMatrices.size())) {
+            m_FinalBoneMatrices[index] = globalTransformation * offset;
+        }
     }
 
     for (const auto& child : node->children) {
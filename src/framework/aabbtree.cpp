@@ -0,0 +1,196 @@
+#include "aabbtree.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+static Bounds merge(const Bounds& a, const Bounds& b) {
+    Bounds bounds = a;
+    bounds.expand(b);
+    return bounds;
+}
+
+AABBTree::AABBTree(float margin) : margin(margin) {}
+
+uint32_t AABBTree::allocateNode() {
+    if (freeList == NONE) {
+        nodes.emplace_back();
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
+
+    uint32_t node = freeList;
+    freeList = nodes[node].parent;
+    nodes[node] = Node();
+    return node;
+}
+
+void AABBTree::freeNode(uint32_t node) {
+    nodes[node].parent = freeList;
+    nodes[node].height = -1;
+    freeList = node;
+}
+
+uint32_t AABBTree::insert(const Bounds& bounds, uint64_t userData) {
+    uint32_t leaf = allocateNode();
+    nodes[leaf].bounds.min = bounds.min - glm::vec3(margin);
+    nodes[leaf].bounds.max = bounds.max + glm::vec3(margin);
+    nodes[leaf].userData = userData;
+
+    insertLeaf(leaf);
+    leaves++;
+
+    return leaf;
+}
+
+void AABBTree::remove(uint32_t proxy) {
+    assert(nodes[proxy].isLeaf());
+
+    removeLeaf(proxy);
+    freeNode(proxy);
+    leaves--;
+}
+
+bool AABBTree::move(uint32_t proxy, const Bounds& bounds) {
+    if (nodes[proxy].bounds.contains(bounds)) return false;
+
+    removeLeaf(proxy);
+    nodes[proxy].bounds.min = bounds.min - glm::vec3(margin);
+    nodes[proxy].bounds.max = bounds.max + glm::vec3(margin);
+    insertLeaf(proxy);
+
+    return true;
+}
+
+void AABBTree::insertLeaf(uint32_t leaf) {
+    if (root == NONE) {
+        root = leaf;
+        nodes[leaf].parent = NONE;
+        return;
+    }
+
+    // descend toward the sibling with the lowest cost: the area of the new parent plus the growth of all ancestors
+    const Bounds leafBounds = nodes[leaf].bounds;
+    uint32_t index = root;
+
+    while (!nodes[index].isLeaf()) {
+        const Node& node = nodes[index];
+
+        float area = node.bounds.area();
+        float combined = merge(node.bounds, leafBounds).area();
+
+        // pairing with this node creates a parent with the combined area
+        float cost = 2.0f * combined;
+        // descending further grows this node in any case
+        float inheritance = 2.0f * (combined - area);
+
+        auto childCost = [&](uint32_t child) {
+            const Bounds& bounds = nodes[child].bounds;
+            float grown = merge(bounds, leafBounds).area();
+            return (nodes[child].isLeaf() ? grown : grown - bounds.area()) + inheritance;
+        };
+
+        float cost1 = childCost(node.child1);
+        float cost2 = childCost(node.child2);
+
+        if (cost < cost1 && cost < cost2) break;
+
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    uint32_t sibling = index;
+    uint32_t oldParent = nodes[sibling].parent;
+    uint32_t newParent = allocateNode();
+
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].bounds = merge(nodes[sibling].bounds, leafBounds);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent != NONE) {
+        (nodes[oldParent].child1 == sibling ? nodes[oldParent].child1 : nodes[oldParent].child2) = newParent;
+    } else {
+        root = newParent;
+    }
+
+    refit(oldParent);
+}
+
+void AABBTree::removeLeaf(uint32_t leaf) {
+    if (leaf == root) {
+        root = NONE;
+        return;
+    }
+
+    uint32_t parent = nodes[leaf].parent;
+    uint32_t grandParent = nodes[parent].parent;
+    uint32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    // the sibling takes the place of the parent
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    if (grandParent != NONE) {
+        (nodes[grandParent].child1 == parent ? nodes[grandParent].child1 : nodes[grandParent].child2) = sibling;
+        refit(grandParent);
+    } else {
+        root = sibling;
+    }
+}
+
+void AABBTree::refit(uint32_t index) {
+    while (index != NONE) {
+        index = balance(index);
+
+        Node& node = nodes[index];
+        node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+        node.bounds = merge(nodes[node.child1].bounds, nodes[node.child2].bounds);
+
+        index = node.parent;
+    }
+}
+
+uint32_t AABBTree::balance(uint32_t index) {
+    const Node& node = nodes[index];
+    if (node.isLeaf() || node.height < 2) return index;
+
+    int difference = nodes[node.child2].height - nodes[node.child1].height;
+
+    if (difference > 1) return rotate(index, node.child2);
+    if (difference < -1) return rotate(index, node.child1);
+
+    return index;
+}
+
+uint32_t AABBTree::rotate(uint32_t index, uint32_t up) {
+    // the taller child up replaces its parent, which keeps the other child and the lower grandchild
+    Node& a = nodes[index];
+    Node& b = nodes[up];
+
+    uint32_t other = a.child1 == up ? a.child2 : a.child1;
+    uint32_t keep = nodes[b.child1].height > nodes[b.child2].height ? b.child1 : b.child2;
+    uint32_t lower = keep == b.child1 ? b.child2 : b.child1;
+
+    b.parent = a.parent;
+    if (b.parent != NONE) {
+        (nodes[b.parent].child1 == index ? nodes[b.parent].child1 : nodes[b.parent].child2) = up;
+    } else {
+        root = up;
+    }
+
+    b.child1 = index;
+    b.child2 = keep;
+    a.parent = up;
+
+    a.child1 = other;
+    a.child2 = lower;
+    nodes[lower].parent = index;
+
+    a.bounds = merge(nodes[other].bounds, nodes[lower].bounds);
+    a.height = 1 + std::max(nodes[other].height, nodes[lower].height);
+    b.bounds = merge(a.bounds, nodes[keep].bounds);
+    b.height = 1 + std::max(a.height, nodes[keep].height);
+
+    return up;
+}
\ No newline at end of file
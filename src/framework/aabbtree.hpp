@@ -0,0 +1,129 @@
+#pragma once
+
+#include "bounds.hpp"
+#include "frustum.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Dynamic bounding volume hierarchy over axis aligned boxes
+ * Leaves store a box enlarged by a margin, so objects that move a little need no update. Leaves are inserted next
+ * to the sibling that grows the surface area the least, and tree rotations on the way back up keep it balanced,
+ * so insert, remove and move take logarithmic time. Queries report the user data of every leaf whose box
+ * overlaps, callers test their exact bounds.
+ */
+class AABBTree {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    explicit AABBTree(float margin = 0.1f);
+
+    // returns the proxy that identifies the leaf
+    uint32_t insert(const Bounds& bounds, uint64_t userData);
+    void remove(uint32_t proxy);
+    // true if the bounds left the enlarged box and the leaf was reinserted
+    bool move(uint32_t proxy, const Bounds& bounds);
+
+    uint64_t getUserData(uint32_t proxy) const { return nodes[proxy].userData; }
+    void setUserData(uint32_t proxy, uint64_t userData) { nodes[proxy].userData = userData; }
+    const Bounds& getBounds(uint32_t proxy) const { return nodes[proxy].bounds; }
+
+    size_t size() const { return leaves; }
+    int getHeight() const { return root != NONE ? nodes[root].height : 0; }
+
+    template <typename Callback>
+    void query(const Frustum& frustum, Callback&& callback) const;
+    template <typename Callback>
+    void query(const glm::vec3& center, float radius, Callback&& callback) const;
+    // leaves the ray from origin hits within maxDistance, direction doesn't need to be normalized
+    template <typename Callback>
+    void raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) const;
+
+private:
+    struct Node {
+        Bounds bounds;
+        uint64_t userData = 0;
+        uint32_t parent = NONE; // next free node while unused
+        uint32_t child1 = NONE;
+        uint32_t child2 = NONE;
+        int height = 0; // leaves are 0, unused nodes -1
+
+        bool isLeaf() const { return child1 == NONE; }
+    };
+
+    uint32_t allocateNode();
+    void freeNode(uint32_t node);
+
+    void insertLeaf(uint32_t leaf);
+    void removeLeaf(uint32_t leaf);
+    // refits and rebalances every node from index up to the root
+    void refit(uint32_t index);
+    uint32_t balance(uint32_t index);
+    uint32_t rotate(uint32_t parent, uint32_t up);
+
+    template <typename Overlaps, typename Callback>
+    void traverse(Overlaps&& overlaps, Callback&& callback) const;
+
+private:
+    std::vector<Node> nodes;
+    uint32_t root = NONE;
+    uint32_t freeList = NONE;
+    size_t leaves = 0;
+    float margin;
+};
+
+template <typename Overlaps, typename Callback>
+inline void AABBTree::traverse(Overlaps&& overlaps, Callback&& callback) const {
+    if (root == NONE) return;
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+
+        if (!overlaps(node.bounds)) continue;
+
+        if (node.isLeaf()) {
+            callback(node.userData);
+        } else {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+template <typename Callback>
+inline void AABBTree::query(const Frustum& frustum, Callback&& callback) const {
+    traverse([&](const Bounds& bounds) { return frustum.intersectsBox(bounds.min, bounds.max); }, callback);
+}
+
+template <typename Callback>
+inline void AABBTree::query(const glm::vec3& center, float radius, Callback&& callback) const {
+    traverse([&](const Bounds& bounds) {
+        glm::vec3 offset = center - glm::clamp(center, bounds.min, bounds.max);
+        return glm::dot(offset, offset) <= radius * radius;
+    }, callback);
+}
+
+template <typename Callback>
+inline void AABBTree::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) const {
+    glm::vec3 inverse = 1.0f / direction;
+
+    traverse([&](const Bounds& bounds) {
+        // slabs, a zero component gives infinite distances with the right sign
+        glm::vec3 t0 = (bounds.min - origin) * inverse;
+        glm::vec3 t1 = (bounds.max - origin) * inverse;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+
+        float enter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+        float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+        return enter <= exit;
+    }, callback);
+}
\ No newline at end of file
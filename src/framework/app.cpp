@@ -11,6 +11,9 @@
 #include <iostream>
 #include <string>
 
+#include "gl/glstate.hpp"
+#include "gl/streambuffer.hpp"
+
 using namespace glm;
 
 App::App(unsigned int width, unsigned int height) : resolution(width, height), time(0.f), delta(0.f), frames(0), imguiEnabled(true) {
@@ -50,7 +53,7 @@ void App::initGLFW() {
     mouse = vec2(x, y);
     // Callbacks
     glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height) {
-        glViewport(0, 0, width, height);
+        GLState::viewport(0, 0, width, height);
         App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
         app->resolution.x = width;
         app->resolution.y = height;
@@ -204,6 +207,9 @@ void App::run() {
         delta = current - time;
         time = current;
         render();
+        // ImGui restores the state it changes and isn't counted
+        GLState::nextFrame();
+        StreamBuffer::nextFrame();
         if (imguiEnabled) renderImGui();
         glfwSwapBuffers(window);
         frames++;
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <limits>
+
+/**
+ * Axis aligned bounding box, empty until the first point is added
+ */
+struct Bounds {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    bool isValid() const { return min.x <= max.x; }
+
+    glm::vec3 center() const { return 0.5f * (min + max); }
+    // half of the size along every axis
+    glm::vec3 extent() const { return 0.5f * (max - min); }
+    // of the sphere around center() that encloses the box
+    float radius() const { return glm::length(extent()); }
+    // surface area, the cost measure of the bounding volume tree
+    float area() const {
+        glm::vec3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    bool contains(const Bounds& other) const {
+        return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+    }
+
+    void expand(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void expand(const Bounds& other) {
+        if (!other.isValid()) return;
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    // box around the transformed box (Arvo)
+    Bounds transformed(const glm::mat4& matrix) const {
+        if (!isValid()) return *this;
+
+        glm::vec3 c = glm::vec3(matrix * glm::vec4(center(), 1.0f));
+        glm::vec3 e = extent();
+        glm::vec3 r = glm::abs(glm::vec3(matrix[0])) * e.x + glm::abs(glm::vec3(matrix[1])) * e.y + glm::abs(glm::vec3(matrix[2])) * e.z;
+
+        Bounds result;
+        result.min = c - r;
+        result.max = c + r;
+        return result;
+    }
+};
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "bufferheap.hpp"
+
+#include "singleton.hpp"
+
+#include <algorithm>
+#include <string>
+
+BufferHeap::State& BufferHeap::state() {
+    return leakedSingleton<State>();
+}
+
+BufferHeap::Allocation BufferHeap::allocate(size_t bytes) {
+    Allocation allocation;
+    if (bytes == 0) return allocation;
+
+    State& s = state();
+    size_t units = (bytes + ALIGNMENT - 1) / ALIGNMENT;
+
+    size_t page;
+    auto it = s.space.lower_bound(units);
+
+    if (it != s.space.end()) {
+        page = it->second;
+    } else {
+        page = s.pages.size();
+        size_t capacity = std::max(units, PAGE_SIZE / ALIGNMENT);
+
+        s.pages.push_back(std::make_unique<Page>());
+        s.pages[page]->buffer.allocate(Buffer::Type::COPY_WRITE_BUFFER, capacity * ALIGNMENT, Buffer::Usage::DYNAMIC_DRAW);
+        s.pages[page]->buffer.label("Buffer heap", "page " + std::to_string(page));
+        s.pages[page]->allocator.grow(capacity);
+        s.pages[page]->space = s.space.end();
+    }
+
+    allocation.range = s.pages[page]->allocator.allocate(units);
+    updateSpace(page);
+
+    allocation.buffer = &s.pages[page]->buffer;
+    allocation.offset = allocation.range.offset * ALIGNMENT;
+    allocation.size = bytes;
+    allocation.page = page;
+
+    return allocation;
+}
+
+void BufferHeap::free(Allocation& allocation) {
+    if (!allocation.isValid()) return;
+
+    state().pages[allocation.page]->allocator.free(allocation.range);
+    updateSpace(allocation.page);
+
+    allocation = Allocation();
+}
+
+void BufferHeap::updateSpace(size_t page) {
+    State& s = state();
+    Page& p = *s.pages[page];
+
+    if (p.space != s.space.end()) s.space.erase(p.space);
+
+    size_t space = p.allocator.getMaxAllocation();
+    p.space = space > 0 ? s.space.emplace(space, page) : s.space.end();
+}
+
+void BufferHeap::upload(const Allocation& allocation, const void* data, size_t bytes, size_t offset) {
+    if (!allocation.isValid() || offset + bytes > allocation.size) return;
+
+    // through the copy target, so the upload doesn't disturb a bound vertex array
+    allocation.buffer->_set(Buffer::Type::COPY_WRITE_BUFFER, bytes, data, allocation.offset + offset);
+}
+
+BufferHeap::Stats BufferHeap::getStats() {
+    Stats stats;
+
+    for (const std::unique_ptr<Page>& page : state().pages) {
+        RangeAllocator::Stats pageStats = page->allocator.getStats();
+
+        stats.pages++;
+        stats.ranges.capacity += pageStats.capacity * ALIGNMENT;
+        stats.ranges.used += pageStats.used * ALIGNMENT;
+        stats.ranges.allocations += pageStats.allocations;
+        stats.ranges.freeRanges += pageStats.freeRanges;
+        stats.ranges.largestFree = std::max(stats.ranges.largestFree, pageStats.largestFree * ALIGNMENT);
+    }
+
+    return stats;
+}
\ No newline at end of file
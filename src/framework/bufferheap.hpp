@@ -0,0 +1,64 @@
+#pragma once
+
+#include "rangeallocator.hpp"
+#include "gl/buffer.hpp"
+
+#include <glad/glad.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+/**
+ * Suballocates small vertex and instance buffers from large buffer pages
+ * Every page is one Buffer managed by a RangeAllocator, so allocation and free are O(1) and the number of GL
+ * buffer objects stays small. Pages are indexed by the largest range they can hand out, allocate() takes the
+ * page with the least sufficient space. Requests larger than a page get a page of their own.
+ * Empty pages are kept for reuse, vertex arrays may still reference their buffer after the last free.
+ */
+class BufferHeap {
+public:
+    static constexpr size_t PAGE_SIZE = 4 << 20;
+    static constexpr size_t ALIGNMENT = 16;
+
+    struct Allocation {
+        Buffer* buffer = nullptr;
+        GLintptr offset = 0; // in bytes from the start of the buffer
+        size_t size = 0;
+
+        bool isValid() const { return buffer != nullptr; }
+
+    private:
+        friend class BufferHeap;
+        size_t page = 0;
+        RangeAllocator::Range range;
+    };
+
+    struct Stats {
+        size_t pages = 0;
+        RangeAllocator::Stats ranges; // summed over all pages, in bytes
+    };
+
+    static Allocation allocate(size_t bytes);
+    static void free(Allocation& allocation);
+    static void upload(const Allocation& allocation, const void* data, size_t bytes, size_t offset = 0);
+
+    static Stats getStats();
+
+private:
+    using SpaceIndex = std::multimap<size_t, size_t>; // getMaxAllocation() of a page to its index
+
+    struct Page {
+        Buffer buffer;
+        RangeAllocator allocator;
+        SpaceIndex::iterator space;
+    };
+
+    struct State {
+        std::vector<std::unique_ptr<Page>> pages; // pointers stay stable while the vector grows
+        SpaceIndex space;
+    };
+
+    static State& state();
+    static void updateSpace(size_t page);
+};
\ No newline at end of file
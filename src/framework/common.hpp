@@ -9,8 +9,10 @@
 #include <assimp/quaternion.h>
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 
 #include <glm/glm.hpp>
@@ -26,6 +28,10 @@ namespace Common {
     template <class T, typename... Rest>
     void hash_combine(std::size_t& seed, const T& v, const Rest&... rest);
 
+    /* 64-bit FNV-1a, stable across runs and platforms unlike std::hash */
+    constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+    constexpr uint64_t fnv1a(std::string_view data, uint64_t hash = FNV_OFFSET);
+
     void randomSeed();
     int randomInt(int min, int max);
     float randomFloat();
@@ -50,6 +56,14 @@ inline void Common::hash_combine(std::size_t& seed, const T& v, const Rest&... r
     (hash_combine(seed, rest), ...);
 }
 
+constexpr uint64_t Common::fnv1a(std::string_view data, uint64_t hash) {
+    for (char c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
 inline std::ostream& operator<<(std::ostream& os, const glm::vec3& vec) {
     os << "vec3(" << vec.x << ", " << vec.y << ", " << vec.z << ")";
     return os;
@@ -0,0 +1,84 @@
+#include "frustum.hpp"
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE
+#endif
+
+Frustum::Frustum(const glm::mat4& toClip) {
+    glm::mat4 m = glm::transpose(toClip);
+
+    planes[0] = m[3] + m[0]; // left
+    planes[1] = m[3] - m[0]; // right
+    planes[2] = m[3] + m[1]; // bottom
+    planes[3] = m[3] - m[1]; // top
+    planes[4] = m[3] + m[2]; // near
+    planes[5] = m[3] - m[2]; // far
+
+    for (glm::vec4& plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const {
+    for (const glm::vec4& plane : planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Frustum::intersectsBox(const glm::vec3& min, const glm::vec3& max) const {
+    for (const glm::vec4& plane : planes) {
+        // the corner furthest along the normal
+        glm::vec3 corner(plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y, plane.z >= 0.0f ? max.z : min.z);
+
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Frustum::intersectSpheres(const float* x, const float* y, const float* z, const float* radius, size_t count, uint8_t* result) const {
+    size_t i = 0;
+
+#ifdef FRUSTUM_SSE
+    __m128 nx[6], ny[6], nz[6], d[6];
+    for (size_t p = 0; p < 6; p++) {
+        nx[p] = _mm_set1_ps(planes[p].x);
+        ny[p] = _mm_set1_ps(planes[p].y);
+        nz[p] = _mm_set1_ps(planes[p].z);
+        d[p] = _mm_set1_ps(planes[p].w);
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 cx = _mm_loadu_ps(x + i);
+        __m128 cy = _mm_loadu_ps(y + i);
+        __m128 cz = _mm_loadu_ps(z + i);
+        __m128 negRadius = _mm_sub_ps(zero, _mm_loadu_ps(radius + i));
+
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (size_t p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_add_ps(_mm_mul_ps(nz[p], cz), d[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (size_t lane = 0; lane < 4; lane++) {
+            result[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        result[i] = intersectsSphere(glm::vec3(x[i], y[i], z[i]), radius[i]) ? 1 : 0;
+    }
+}
\ No newline at end of file
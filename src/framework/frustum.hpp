@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * View frustum given by six planes, extracted from a clip space matrix (Gribb/Hartmann).
+ * The planes live in the space the matrix transforms from, so passing worldToClip * localToWorld
+ * yields planes that can be tested directly against object space bounds.
+ */
+class Frustum {
+   public:
+    Frustum(const glm::mat4& toClip);
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const;
+    bool intersectsBox(const glm::vec3& min, const glm::vec3& max) const;
+    // Tests count spheres stored as separate coordinate arrays, four at a time where SSE is available.
+    // result[i] is 1 if sphere i intersects the frustum.
+    void intersectSpheres(const float* x, const float* y, const float* z, const float* radius, size_t count, uint8_t* result) const;
+
+   private:
+    /* Plane equations (normal, distance) with normals pointing inside */
+    std::array<glm::vec4, 6> planes;
+};
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include "geometryarena.hpp"
+
+#include "mesh.hpp"
+#include "singleton.hpp"
+#include "gl/gpumemory.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+
+// initial capacity in elements, pools double when they run out
+static const size_t MIN_CAPACITY = 1 << 16;
+
+GeometryArena::State& GeometryArena::state() {
+    return leakedSingleton<State>();
+}
+
+const char* GeometryArena::getName(Format format) {
+    switch (format) {
+        case Format::P: return "P vertices";
+        case Format::PCN: return "PCN vertices";
+        case Format::PCNT: return "PCNT vertices";
+        case Format::PCNTB: return "PCNTB vertices";
+        default: return "vertices";
+    }
+}
+
+size_t GeometryArena::vertexSize(Format format) {
+    switch (format) {
+        case Format::P: return 3 * sizeof(float);
+        case Format::PCN: return sizeof(Mesh::VertexPCN);
+        case Format::PCNT: return sizeof(Mesh::VertexPCNT);
+        case Format::PCNTB: return sizeof(Mesh::VertexPCNTB);
+        default: return 0;
+    }
+}
+
+uint64_t GeometryArena::rangeKey(const Allocation& allocation) {
+    // vertex range nodes are unique per format while allocated
+    return static_cast<uint64_t>(allocation.format) << 32 | allocation.vertexRange.node;
+}
+
+RangeAllocator::Range GeometryArena::reserve(Pool& pool, size_t elementSize, size_t count) {
+    RangeAllocator::Range range = pool.allocator.allocate(count);
+    if (range.isValid()) return range;
+
+    size_t oldCapacity = pool.allocator.getCapacity();
+    size_t newCapacity = std::max({ 2 * oldCapacity, oldCapacity + count, MIN_CAPACITY });
+
+    resize(pool, elementSize, newCapacity);
+    pool.allocator.grow(newCapacity);
+
+    return pool.allocator.allocate(count);
+}
+
+void GeometryArena::resize(Pool& pool, size_t elementSize, size_t capacity) {
+    // move the contents into a new buffer, the ranges keep their offsets
+    size_t used = std::min(pool.allocator.getEnd(), capacity);
+
+    Buffer buffer;
+    buffer.allocate(Buffer::Type::COPY_WRITE_BUFFER, capacity * elementSize);
+
+    if (used > 0) {
+        pool.buffer.bind(Buffer::Type::COPY_READ_BUFFER);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used * elementSize);
+    }
+
+    pool.buffer = std::move(buffer);
+}
+
+bool GeometryArena::trim(Pool& pool, size_t elementSize) {
+    // shrink to twice the used end once a quarter or less is in use, so growing again takes a while
+    size_t capacity = pool.allocator.getCapacity();
+    size_t end = pool.allocator.getEnd();
+    size_t newCapacity = std::max(2 * end, MIN_CAPACITY);
+    if (capacity <= MIN_CAPACITY || end > capacity / 4 || newCapacity >= capacity) return false;
+
+    resize(pool, elementSize, newCapacity);
+    pool.allocator.shrink(newCapacity);
+    return true;
+}
+
+GeometryArena::Allocation GeometryArena::allocate(Format format, const void* vertices, size_t vertexCount, const std::vector<unsigned int>& indices) {
+    Allocation allocation;
+    if (vertexCount == 0 || indices.empty()) return allocation;
+
+    State& s = state();
+    Pool& vertexPool = s.vertices[static_cast<size_t>(format)];
+    size_t size = vertexSize(format);
+
+    allocation.format = format;
+    allocation.vertexCount = vertexCount;
+    allocation.indexCount = indices.size();
+
+    GLuint vertexBuffer = vertexPool.buffer.handle;
+    allocation.vertexRange = reserve(vertexPool, size, vertexCount);
+    allocation.baseVertex = static_cast<GLint>(allocation.vertexRange.offset);
+
+    if (vertexPool.buffer.handle != vertexBuffer) {
+        vertexPool.buffer.label("Meshes", getName(format));
+        setupVertexArray(format);
+    }
+
+    GLuint indexBuffer = s.indices.buffer.handle;
+    allocation.indexRange = reserve(s.indices, sizeof(unsigned int), indices.size());
+    allocation.firstIndex = static_cast<GLuint>(allocation.indexRange.offset);
+
+    if (s.indices.buffer.handle != indexBuffer) {
+        s.indices.buffer.label("Meshes", "indices");
+
+        // the index buffer binding is part of every vertex array
+        for (size_t i = 0; i < s.vertexArrays.size(); i++) {
+            setupVertexArray(static_cast<Format>(i));
+        }
+    }
+
+    // uploads go through the copy target, so they can't touch the index buffer of a bound vertex array
+    vertexPool.buffer._set(Buffer::Type::COPY_WRITE_BUFFER, vertexCount * size, vertices, allocation.vertexRange.offset * size);
+    s.indices.buffer._set(Buffer::Type::COPY_WRITE_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), allocation.firstIndex * sizeof(unsigned int));
+
+    GpuMemory::trackRange(rangeKey(allocation), "Meshes", vertexCount * size + indices.size() * sizeof(unsigned int));
+
+    return allocation;
+}
+
+void GeometryArena::free(Allocation& allocation) {
+    if (!allocation.isValid()) return;
+
+    State& s = state();
+    Format format = allocation.format;
+    Pool& vertexPool = s.vertices[static_cast<size_t>(format)];
+
+    GpuMemory::untrackRange(rangeKey(allocation));
+    vertexPool.allocator.free(allocation.vertexRange);
+    s.indices.allocator.free(allocation.indexRange);
+
+    allocation = Allocation();
+
+    // evicted meshes give their memory back once the end of a pool is free
+    if (trim(vertexPool, vertexSize(format))) {
+        vertexPool.buffer.label("Meshes", getName(format));
+        setupVertexArray(format);
+    }
+
+    if (trim(s.indices, sizeof(unsigned int))) {
+        s.indices.buffer.label("Meshes", "indices");
+
+        for (size_t i = 0; i < s.vertexArrays.size(); i++) {
+            setupVertexArray(static_cast<Format>(i));
+        }
+    }
+}
+
+void GeometryArena::label(const Allocation& allocation, const std::string& name) {
+    if (allocation.isValid()) GpuMemory::labelRange(rangeKey(allocation), name);
+}
+
+void GeometryArena::setupVertexArray(Format format) {
+    State& s = state();
+    size_t index = static_cast<size_t>(format);
+    Buffer& vertices = s.vertices[index].buffer;
+
+    s.vertexArrays[index].bind();
+
+    // formats without vertices yet only get the index buffer
+    if (s.vertices[index].allocator.getCapacity() > 0) {
+        vertices.bind(Buffer::Type::ARRAY_BUFFER);
+
+        switch (format) {
+            case Format::P:
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*) 0);
+                glEnableVertexAttribArray(0);
+                break;
+
+            case Format::PCN: {
+                size_t stride = sizeof(Mesh::VertexPCN);
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Mesh::VertexPCN, position));
+                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Mesh::VertexPCN, texCoord));
+                glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Mesh::VertexPCN, normal));
+                for (GLuint i = 0; i < 3; i++) glEnableVertexAttribArray(i);
+                break;
+            }
+
+            case Format::PCNT: {
+                size_t stride = sizeof(Mesh::VertexPCNT);
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Mesh::VertexPCNT, position));
+                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Mesh::VertexPCNT, texCoord));
+                glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Mesh::VertexPCNT, normal));
+                glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Mesh::VertexPCNT, tangent));
+                for (GLuint i = 0; i < 4; i++) glEnableVertexAttribArray(i);
+                break;
+            }
+
+            case Format::PCNTB: {
+                size_t stride = sizeof(Mesh::VertexPCNTB);
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Mesh::VertexPCNTB, position));
+                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Mesh::VertexPCNTB, texCoord));
+                glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Mesh::VertexPCNTB, normal));
+                glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Mesh::VertexPCNTB, tangent));
+                glVertexAttribIPointer(4, 4, GL_INT, stride, (void*)offsetof(Mesh::VertexPCNTB, boneIDs)); // better not forget the "I" when using integers
+                glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Mesh::VertexPCNTB, weights));
+                for (GLuint i = 0; i < 6; i++) glEnableVertexAttribArray(i);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    if (s.indices.allocator.getCapacity() > 0) {
+        s.indices.buffer.bind(Buffer::Type::INDEX_BUFFER);
+    }
+}
+
+void GeometryArena::bind(Format format) {
+    state().vertexArrays[static_cast<size_t>(format)].bind();
+}
+
+void GeometryArena::bindInstances(Format format, Buffer& instances, size_t first) {
+    State& s = state();
+    size_t index = static_cast<size_t>(format);
+
+    s.vertexArrays[index].bind();
+    instances.bind(Buffer::Type::ARRAY_BUFFER);
+
+    size_t stride = sizeof(Instance);
+    size_t base = first * stride;
+
+    for (GLuint i = 0; i < 4; i++) {
+        glVertexAttribPointer(INSTANCE_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(Instance, localToWorld) + i * sizeof(glm::vec4)));
+    }
+
+    for (GLuint i = 0; i < 3; i++) {
+        glVertexAttribPointer(INSTANCE_ATTRIBUTE + 4 + i, 3, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(Instance, normalMatrix) + i * sizeof(glm::vec3)));
+    }
+
+    if (!s.instancing[index]) {
+        for (GLuint i = 0; i < 7; i++) {
+            glEnableVertexAttribArray(INSTANCE_ATTRIBUTE + i);
+            glVertexAttribDivisor(INSTANCE_ATTRIBUTE + i, 1);
+        }
+        s.instancing[index] = true;
+    }
+}
+
+bool GeometryArena::hasMultiDrawIndirect() {
+    static const bool supported = [] {
+#if defined(GL_VERSION_4_3) && defined(GL_ARB_multi_draw_indirect) && defined(GL_ARB_base_instance)
+        return GLAD_GL_VERSION_4_3 || (GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_base_instance);
+#elif defined(GL_VERSION_4_3)
+        return GLAD_GL_VERSION_4_3 != 0;
+#else
+        return false;
+#endif
+    }();
+    return supported;
+}
+
+void GeometryArena::drawIndirect(Format format, Buffer& instances, Buffer& commands, size_t first, GLsizei count) {
+    // base instances select the instance of every command, so the attributes start at the first one
+    bindInstances(format, instances, 0);
+    commands.bind(Buffer::Type::DRAW_INDIRECT_BUFFER);
+
+#ifdef GL_VERSION_4_3
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(first * sizeof(DrawCommand)), count, 0);
+#endif
+}
+
+RangeAllocator::Stats GeometryArena::getVertexStats(Format format) {
+    return state().vertices[static_cast<size_t>(format)].allocator.getStats();
+}
+
+RangeAllocator::Stats GeometryArena::getIndexStats() {
+    return state().indices.allocator.getStats();
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "rangeallocator.hpp"
+#include "gl/buffer.hpp"
+#include "gl/vertexarray.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Vertex and index storage shared by all meshes
+ * Every vertex format has one vertex buffer and vertex array, all formats share one index buffer. Meshes address
+ * their range with a base vertex and a first index, so draws of meshes with the same format need no rebinding
+ * and can be submitted together with glMultiDrawElementsIndirect.
+ * Every allocation is reported to GpuMemory under its mesh name, and pools shrink again once frees leave
+ * most of their end unused.
+ */
+class GeometryArena {
+public:
+    enum class Format {
+        P,     // position only
+        PCN,   // Mesh::VertexPCN
+        PCNT,  // Mesh::VertexPCNT
+        PCNTB, // Mesh::VertexPCNTB
+        COUNT
+    };
+
+    struct Allocation {
+        Format format = Format::P;
+        GLint baseVertex = 0;
+        size_t vertexCount = 0;
+        GLuint firstIndex = 0;
+        GLsizei indexCount = 0;
+        RangeAllocator::Range vertexRange;
+        RangeAllocator::Range indexRange;
+
+        bool isValid() const { return vertexCount > 0; }
+    };
+
+    /* Per-instance attributes, see shaders/instancing.glsl */
+    struct Instance {
+        glm::mat4 localToWorld;
+        glm::mat3 normalMatrix;
+    };
+
+    /* Layout expected by glMultiDrawElementsIndirect */
+    struct DrawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    static const GLuint INSTANCE_ATTRIBUTE = 8; // localToWorld at 8-11, normalMatrix at 12-14
+
+    static Allocation allocate(Format format, const void* vertices, size_t vertexCount, const std::vector<unsigned int>& indices);
+    static void free(Allocation& allocation);
+    // name the allocation is listed under in GpuMemory
+    static void label(const Allocation& allocation, const std::string& name);
+
+    static void bind(Format format);
+    // points the instance attributes of the format at the buffer, starting at instance first
+    static void bindInstances(Format format, Buffer& instances, size_t first);
+
+    // glMultiDrawElementsIndirect with base instances needs OpenGL 4.3 or ARB_multi_draw_indirect
+    static bool hasMultiDrawIndirect();
+    static void drawIndirect(Format format, Buffer& instances, Buffer& commands, size_t first, GLsizei count);
+
+    // in elements of the pool
+    static RangeAllocator::Stats getVertexStats(Format format);
+    static RangeAllocator::Stats getIndexStats();
+    static const char* getName(Format format);
+
+private:
+    struct Pool {
+        Buffer buffer;
+        RangeAllocator allocator;
+    };
+
+    struct State {
+        std::array<VertexArray, static_cast<size_t>(Format::COUNT)> vertexArrays;
+        std::array<Pool, static_cast<size_t>(Format::COUNT)> vertices;
+        Pool indices;
+        std::array<bool, static_cast<size_t>(Format::COUNT)> instancing = {};
+    };
+
+    static State& state();
+    static size_t vertexSize(Format format);
+    static uint64_t rangeKey(const Allocation& allocation);
+    static RangeAllocator::Range reserve(Pool& pool, size_t elementSize, size_t count);
+    static void resize(Pool& pool, size_t elementSize, size_t capacity);
+    // returns true if the buffer of the pool was replaced
+    static bool trim(Pool& pool, size_t elementSize);
+    static void setupVertexArray(Format format);
+};
\ No newline at end of file
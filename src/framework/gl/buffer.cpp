@@ -3,8 +3,12 @@
 #include <glad/glad.h>
 
 #include <cassert>
+#include <string>
 #include <vector>
 
+#include "glstate.hpp"
+#include "gpumemory.hpp"
+
 /////////////////////// RAII behavior ///////////////////////
 Buffer::Buffer() {
     glGenBuffers(1, &handle);
@@ -29,21 +33,30 @@ Buffer::~Buffer() {
 }
 
 void Buffer::release() {
-    if (handle) glDeleteBuffers(1, &handle);
+    if (handle) {
+        GpuMemory::untrack(GpuMemory::Object::BUFFER, handle);
+        GLState::forget(GLState::Category::BUFFER, handle);
+        glDeleteBuffers(1, &handle);
+    }
 }
 /////////////////////////////////////////////////////////////
 
 void Buffer::bind(Type type) {
-    glBindBuffer(static_cast<GLenum>(type), handle);
+    GLState::bindBuffer(static_cast<GLenum>(type), handle);
 }
 
 void Buffer::bind(Type type, GLuint index) {
-    glBindBufferBase(static_cast<GLenum>(type), index, handle);
+    GLState::bindBufferBase(static_cast<GLenum>(type), index, handle);
+}
+
+void Buffer::bind(Type type, GLuint index, GLintptr offset, GLsizeiptr size) {
+    GLState::bindBufferRange(static_cast<GLenum>(type), index, handle, offset, size);
 }
 
 void Buffer::_load(Type type, GLsizeiptr size, const GLvoid* data, Usage usage) {
     bind(type);
     glBufferData(static_cast<GLenum>(type), size, data, static_cast<GLenum>(usage));
+    GpuMemory::track(GpuMemory::Object::BUFFER, handle, size);
 }
 
 void Buffer::_set(Type type, GLsizeiptr size, const GLvoid* data, GLintptr offset) {
@@ -54,4 +67,17 @@ void Buffer::_set(Type type, GLsizeiptr size, const GLvoid* data, GLintptr offse
 void Buffer::allocate(Type type, GLsizeiptr size, Usage usage) {
     bind(type);
     glBufferData(static_cast<GLenum>(type), size, nullptr, static_cast<GLenum>(usage));
+    GpuMemory::track(GpuMemory::Object::BUFFER, handle, size);
+}
+
+void Buffer::storage(Type type, GLsizeiptr size, GLbitfield flags) {
+    bind(type);
+#ifdef GL_VERSION_4_4
+    glBufferStorage(static_cast<GLenum>(type), size, nullptr, flags);
+    GpuMemory::track(GpuMemory::Object::BUFFER, handle, size);
+#endif
+}
+
+void Buffer::label(const std::string& category, const std::string& name) {
+    GpuMemory::label(GpuMemory::Object::BUFFER, handle, category, name);
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <glad/glad.h>
 
+#include <string>
 #include <vector>
 
 /**
@@ -13,10 +14,15 @@ class Buffer {
         ARRAY_BUFFER = GL_ARRAY_BUFFER,
         UNIFORM_BUFFER = GL_UNIFORM_BUFFER,
         INDEX_BUFFER = GL_ELEMENT_ARRAY_BUFFER,
+        TEXTURE_BUFFER = GL_TEXTURE_BUFFER,
+        COPY_READ_BUFFER = GL_COPY_READ_BUFFER,
+        COPY_WRITE_BUFFER = GL_COPY_WRITE_BUFFER,
+        DRAW_INDIRECT_BUFFER = GL_DRAW_INDIRECT_BUFFER,
     };
     enum class Usage {
         STATIC_DRAW = GL_STATIC_DRAW,
         DYNAMIC_DRAW = GL_DYNAMIC_DRAW,
+        STREAM_DRAW = GL_STREAM_DRAW,
     };
     
     Buffer();
@@ -29,6 +35,7 @@ class Buffer {
     ~Buffer();
     void bind(Type type);
     void bind(Type type, GLuint index);
+    void bind(Type type, GLuint index, GLintptr offset, GLsizeiptr size);
 
     void _load(Type type, GLsizeiptr size, const GLvoid* data, Usage usage = Usage::STATIC_DRAW);
     template <typename T>
@@ -43,6 +50,10 @@ class Buffer {
     void set(Type type, const T& data, unsigned int offset = 0);
 
     void allocate(Type type, GLsizeiptr size, Usage usage = Usage::STATIC_DRAW);
+    // Immutable storage, needs OpenGL 4.4 or ARB_buffer_storage
+    void storage(Type type, GLsizeiptr size, GLbitfield flags);
+    // Category and name under which the memory shows up in GpuMemory
+    void label(const std::string& category, const std::string& name);
 
     GLuint handle;
 
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string_view>
+
+/**
+ * Shader sources compiled into the executable
+ * The table is generated from shaders/ at build time by cmake/embedshaders.cmake and sorted by name.
+ */
+namespace EmbeddedShaders {
+
+struct Entry {
+    std::string_view name; // relative to Config::SHADER_DIR
+    std::string_view source;
+};
+
+const Entry* begin();
+const Entry* end();
+// nullptr if there is no shader with this name
+const Entry* find(std::string_view name);
+
+} // namespace EmbeddedShaders
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <iostream>
 
+#include "framework/gl/glstate.hpp"
 #include "framework/gl/texture.hpp"
 
 /////////////////////// RAII behavior ///////////////////////
@@ -32,16 +33,19 @@ Framebuffer::~Framebuffer() {
 }
 
 void Framebuffer::release() {
-    if (handle) glDeleteFramebuffers(1, &handle);
+    if (handle) {
+        GLState::forget(GLState::Category::FRAMEBUFFER, handle);
+        glDeleteFramebuffers(1, &handle);
+    }
 }
 /////////////////////////////////////////////////////////////
 
 void Framebuffer::bind(Type type) {
-    glBindFramebuffer(static_cast<GLenum>(type), handle);
+    GLState::bindFramebuffer(static_cast<GLenum>(type), handle);
 }
 
 void Framebuffer::bindDefault(Type type) {
-    glBindFramebuffer(static_cast<GLenum>(type), 0);
+    GLState::bindFramebuffer(static_cast<GLenum>(type), 0);
 }
 
 void Framebuffer::attach(Type type, Attachment attachment, Texture texture, GLint level) {
@@ -0,0 +1,257 @@
+#include "glstate.hpp"
+
+#include "framework/singleton.hpp"
+
+#include <glad/glad.h>
+
+GLState::State::State() {
+    for (auto& unit : textures) unit.fill(UNKNOWN);
+}
+
+GLState::State& GLState::state() {
+    return leakedSingleton<State>();
+}
+
+bool GLState::change(Category category, bool changed) {
+    Counter& counter = state().counters[static_cast<size_t>(category)];
+    if (changed) {
+        counter.issued++;
+    } else {
+        counter.skipped++;
+    }
+    return changed;
+}
+
+void GLState::useProgram(GLuint program) {
+    if (change(Category::PROGRAM, state().program != program)) {
+        glUseProgram(program);
+        state().program = program;
+    }
+}
+
+void GLState::bindVertexArray(GLuint vao) {
+    if (change(Category::VERTEX_ARRAY, state().vertexArray != vao)) {
+        glBindVertexArray(vao);
+        state().vertexArray = vao;
+    }
+}
+
+int GLState::textureTarget(GLenum target) {
+    switch (target) {
+        case GL_TEXTURE_1D: return 0;
+        case GL_TEXTURE_2D: return 1;
+        case GL_TEXTURE_3D: return 2;
+        case GL_TEXTURE_CUBE_MAP: return 3;
+        case GL_TEXTURE_BUFFER: return 4;
+        default: return -1;
+    }
+}
+
+void GLState::activeTexture(GLuint unit) {
+    if (change(Category::TEXTURE, state().activeTexture != unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        state().activeTexture = unit;
+    }
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture) {
+    State& s = state();
+    int index = textureTarget(target);
+
+    // untracked targets and units are always bound
+    if (index < 0 || s.activeTexture >= MAX_TEXTURE_UNITS) {
+        change(Category::TEXTURE, true);
+        glBindTexture(target, texture);
+        if (index < 0) return;
+        // the active unit is unknown, so nothing is known about any unit
+        for (auto& unit : s.textures) unit[index] = UNKNOWN;
+        return;
+    }
+
+    GLuint& bound = s.textures[s.activeTexture][index];
+    if (change(Category::TEXTURE, bound != texture)) {
+        glBindTexture(target, texture);
+        bound = texture;
+    }
+}
+
+void GLState::bindTexture(GLenum target, GLuint unit, GLuint texture) {
+    State& s = state();
+    int index = textureTarget(target);
+
+    if (index >= 0 && unit < MAX_TEXTURE_UNITS && s.textures[unit][index] == texture) {
+        change(Category::TEXTURE, false);
+        return;
+    }
+
+    activeTexture(unit);
+    bindTexture(target, texture);
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer) {
+    // the index buffer binding is part of the vertex array, so it can't be tracked globally
+    if (target == GL_ELEMENT_ARRAY_BUFFER) {
+        change(Category::BUFFER, true);
+        glBindBuffer(target, buffer);
+        return;
+    }
+
+    auto it = state().buffers.find(target);
+    if (change(Category::BUFFER, it == state().buffers.end() || it->second != buffer)) {
+        glBindBuffer(target, buffer);
+        state().buffers[target] = buffer;
+    }
+}
+
+void GLState::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    // indexed bindings are rare and also capture the buffer size, always issue them
+    change(Category::BUFFER, true);
+    glBindBufferBase(target, index, buffer);
+    // also binds the generic binding point
+    state().buffers[target] = buffer;
+}
+
+void GLState::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    change(Category::BUFFER, true);
+    glBindBufferRange(target, index, buffer, offset, size);
+    state().buffers[target] = buffer;
+}
+
+void GLState::bindFramebuffer(GLenum target, GLuint framebuffer) {
+    State& s = state();
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+
+    if (change(Category::FRAMEBUFFER, (draw && s.drawFramebuffer != framebuffer) || (read && s.readFramebuffer != framebuffer))) {
+        glBindFramebuffer(target, framebuffer);
+        if (draw) s.drawFramebuffer = framebuffer;
+        if (read) s.readFramebuffer = framebuffer;
+    }
+}
+
+void GLState::enable(GLenum capability) {
+    setEnabled(capability, true);
+}
+
+void GLState::disable(GLenum capability) {
+    setEnabled(capability, false);
+}
+
+void GLState::setEnabled(GLenum capability, bool enabled) {
+    auto it = state().capabilities.find(capability);
+    if (change(Category::CAPABILITY, it == state().capabilities.end() || it->second != enabled)) {
+        if (enabled) {
+            glEnable(capability);
+        } else {
+            glDisable(capability);
+        }
+        state().capabilities[capability] = enabled;
+    }
+}
+
+bool GLState::isEnabled(GLenum capability) {
+    auto it = state().capabilities.find(capability);
+    if (it != state().capabilities.end()) return it->second;
+
+    bool enabled = glIsEnabled(capability) == GL_TRUE;
+    state().capabilities[capability] = enabled;
+    return enabled;
+}
+
+void GLState::viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    std::array<GLint, 4> viewport = { x, y, width, height };
+    if (change(Category::FIXED_FUNCTION, state().viewport != viewport)) {
+        glViewport(x, y, width, height);
+        state().viewport = viewport;
+    }
+}
+
+void GLState::cullFace(GLenum mode) {
+    if (change(Category::FIXED_FUNCTION, state().cullFace != mode)) {
+        glCullFace(mode);
+        state().cullFace = mode;
+    }
+}
+
+void GLState::depthFunc(GLenum func) {
+    if (change(Category::FIXED_FUNCTION, state().depthFunc != func)) {
+        glDepthFunc(func);
+        state().depthFunc = func;
+    }
+}
+
+void GLState::depthMask(GLboolean enabled) {
+    if (change(Category::FIXED_FUNCTION, state().depthMask != enabled)) {
+        glDepthMask(enabled);
+        state().depthMask = enabled;
+    }
+}
+
+void GLState::colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+    std::array<GLint, 4> mask = { red, green, blue, alpha };
+    if (change(Category::FIXED_FUNCTION, state().colorMask != mask)) {
+        glColorMask(red, green, blue, alpha);
+        state().colorMask = mask;
+    }
+}
+
+void GLState::forget(Category category, GLuint handle) {
+    State& s = state();
+    switch (category) {
+        case Category::PROGRAM:
+            if (s.program == handle) s.program = UNKNOWN;
+            break;
+        case Category::VERTEX_ARRAY:
+            if (s.vertexArray == handle) s.vertexArray = UNKNOWN;
+            break;
+        case Category::TEXTURE:
+            for (auto& unit : s.textures) {
+                for (GLuint& texture : unit) {
+                    if (texture == handle) texture = UNKNOWN;
+                }
+            }
+            break;
+        case Category::BUFFER:
+            for (auto& [target, buffer] : s.buffers) {
+                if (buffer == handle) buffer = UNKNOWN;
+            }
+            break;
+        case Category::FRAMEBUFFER:
+            if (s.drawFramebuffer == handle) s.drawFramebuffer = UNKNOWN;
+            if (s.readFramebuffer == handle) s.readFramebuffer = UNKNOWN;
+            break;
+        default:
+            break;
+    }
+}
+
+void GLState::invalidate() {
+    State& s = state();
+    Counters counters = s.counters;
+    Counters lastFrame = s.lastFrame;
+    s = State();
+    s.counters = counters;
+    s.lastFrame = lastFrame;
+}
+
+const GLState::Counters& GLState::getCounters() {
+    return state().lastFrame;
+}
+
+void GLState::nextFrame() {
+    state().lastFrame = state().counters;
+    state().counters = Counters();
+}
+
+const char* GLState::getName(Category category) {
+    switch (category) {
+        case Category::PROGRAM: return "Programs";
+        case Category::VERTEX_ARRAY: return "Vertex arrays";
+        case Category::TEXTURE: return "Textures";
+        case Category::BUFFER: return "Buffers";
+        case Category::FRAMEBUFFER: return "Framebuffers";
+        case Category::CAPABILITY: return "Enable/disable";
+        case Category::FIXED_FUNCTION: return "Fixed function";
+        default: return "";
+    }
+}
\ No newline at end of file
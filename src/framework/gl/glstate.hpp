@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <unordered_map>
+
+/**
+ * Shadow copy of the OpenGL binding and fixed function state
+ * All wrappers bind through here, so calls that would not change the state never reach the driver
+ * Code that changes state with raw GL calls has to restore it (ImGui's backend does) or call invalidate()
+ */
+class GLState {
+   public:
+    enum class Category {
+        PROGRAM,
+        VERTEX_ARRAY,
+        TEXTURE,
+        BUFFER,
+        FRAMEBUFFER,
+        CAPABILITY,  // glEnable/glDisable
+        FIXED_FUNCTION, // viewport, face culling, depth function, write masks
+        COUNT
+    };
+    struct Counter {
+        size_t issued = 0;
+        size_t skipped = 0;
+    };
+    using Counters = std::array<Counter, static_cast<size_t>(Category::COUNT)>;
+
+    static constexpr GLuint MAX_TEXTURE_UNITS = 16;
+
+    static void useProgram(GLuint program);
+    static void bindVertexArray(GLuint vao);
+    // binds to the active unit, used for uploads
+    static void bindTexture(GLenum target, GLuint texture);
+    static void bindTexture(GLenum target, GLuint unit, GLuint texture);
+    static void bindBuffer(GLenum target, GLuint buffer);
+    static void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    static void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    static void bindFramebuffer(GLenum target, GLuint framebuffer);
+
+    static void enable(GLenum capability);
+    static void disable(GLenum capability);
+    static void setEnabled(GLenum capability, bool enabled);
+    // asks the driver once if the capability was never set through here
+    static bool isEnabled(GLenum capability);
+    static void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    static void cullFace(GLenum mode);
+    static void depthFunc(GLenum func);
+    static void depthMask(GLboolean enabled);
+    static void colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+
+    // OpenGL unbinds deleted objects, their names may be reused afterwards
+    static void forget(Category category, GLuint handle);
+    // the next call of every kind reaches the driver again
+    static void invalidate();
+
+    // counters of the last finished frame
+    static const Counters& getCounters();
+    static void nextFrame();
+    static const char* getName(Category category);
+
+   private:
+    static constexpr GLuint UNKNOWN = ~0u;
+    static constexpr size_t TEXTURE_TARGETS = 5;
+
+    struct State {
+        GLuint program = UNKNOWN;
+        GLuint vertexArray = UNKNOWN;
+        GLuint activeTexture = UNKNOWN;
+        std::array<std::array<GLuint, TEXTURE_TARGETS>, MAX_TEXTURE_UNITS> textures;
+        std::unordered_map<GLenum, GLuint> buffers;
+        GLuint drawFramebuffer = UNKNOWN;
+        GLuint readFramebuffer = UNKNOWN;
+        std::unordered_map<GLenum, bool> capabilities;
+        std::array<GLint, 4> viewport = { -1, -1, -1, -1 };
+        GLenum cullFace = GL_NONE;
+        GLenum depthFunc = GL_NONE;
+        GLint depthMask = -1;
+        std::array<GLint, 4> colorMask = { -1, -1, -1, -1 };
+
+        Counters counters;
+        Counters lastFrame;
+
+        State();
+    };
+
+    static State& state();
+    // returns true if the call has to be issued
+    static bool change(Category category, bool changed);
+    static void activeTexture(GLuint unit);
+    static int textureTarget(GLenum target);
+};
\ No newline at end of file
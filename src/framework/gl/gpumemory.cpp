@@ -0,0 +1,163 @@
+#include "gpumemory.hpp"
+
+#include "framework/singleton.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+void GpuMemory::track(Object object, GLuint handle, size_t bytes) {
+    Allocation& allocation = state().allocations[{object, handle}];
+
+    // reallocating replaces the old storage
+    state().total = state().total - allocation.bytes + bytes;
+    allocation.bytes = bytes;
+
+    if (allocation.category.empty()) {
+        allocation.category = object == Object::TEXTURE ? "Textures" : "Buffers";
+    }
+
+    checkBudget();
+}
+
+void GpuMemory::untrack(Object object, GLuint handle) {
+    auto it = state().allocations.find({object, handle});
+    if (it == state().allocations.end()) return;
+
+    state().total -= it->second.bytes;
+    state().allocations.erase(it);
+
+    checkBudget();
+}
+
+void GpuMemory::label(Object object, GLuint handle, const std::string& category, const std::string& name) {
+    Allocation& allocation = state().allocations[{object, handle}];
+    allocation.category = category;
+    allocation.name = name;
+}
+
+void GpuMemory::trackRange(uint64_t key, const std::string& category, size_t bytes) {
+    Allocation& range = state().ranges[key];
+    range.category = category;
+    range.bytes = bytes;
+}
+
+void GpuMemory::labelRange(uint64_t key, const std::string& name) {
+    auto it = state().ranges.find(key);
+    if (it != state().ranges.end()) it->second.name = name;
+}
+
+void GpuMemory::untrackRange(uint64_t key) {
+    state().ranges.erase(key);
+}
+
+size_t GpuMemory::getTotal() {
+    return state().total;
+}
+
+std::map<std::string, size_t> GpuMemory::getCategoryTotals() {
+    std::map<std::string, size_t> totals;
+    for (const auto& [key, allocation] : state().allocations) {
+        totals[allocation.category] += allocation.bytes;
+    }
+    return totals;
+}
+
+std::vector<GpuMemory::Allocation> GpuMemory::getAllocations() {
+    // merge the buffers, textures and ranges that belong to the same named asset
+    std::map<std::pair<std::string, std::string>, size_t> named;
+    std::map<std::string, size_t> rangeTotals;
+    for (const auto& [key, range] : state().ranges) {
+        named[{range.category, range.name}] += range.bytes;
+        rangeTotals[range.category] += range.bytes;
+    }
+
+    // suballocated buffers only contribute the space their ranges don't cover
+    std::map<std::string, size_t> suballocated;
+    for (const auto& [key, allocation] : state().allocations) {
+        if (rangeTotals.count(allocation.category)) {
+            suballocated[allocation.category] += allocation.bytes;
+        } else {
+            named[{allocation.category, allocation.name}] += allocation.bytes;
+        }
+    }
+    for (const auto& [category, bytes] : suballocated) {
+        named[{category, "(unused)"}] += bytes - std::min(bytes, rangeTotals[category]);
+    }
+
+    std::vector<Allocation> result;
+    for (const auto& [key, bytes] : named) {
+        result.push_back({key.first, key.second, bytes});
+    }
+    return result;
+}
+
+void GpuMemory::setBudget(size_t bytes) {
+    state().budget = bytes;
+    state().overBudget = false;
+    checkBudget();
+}
+
+size_t GpuMemory::getBudget() {
+    return state().budget;
+}
+
+size_t GpuMemory::bytesPerPixel(GLenum internalformat) {
+    switch (internalformat) {
+        case GL_R8:
+        case GL_R8_SNORM:
+        case GL_RED:
+            return 1;
+        case GL_RG8:
+        case GL_RG8_SNORM:
+        case GL_R16F:
+        case GL_DEPTH_COMPONENT16:
+            return 2;
+        case GL_RGB8:
+        case GL_RGB8_SNORM:
+        case GL_SRGB8:
+        case GL_RGB:
+        case GL_DEPTH_COMPONENT24:
+            return 3;
+        case GL_RGBA8:
+        case GL_RGBA8_SNORM:
+        case GL_SRGB8_ALPHA8:
+        case GL_RGBA:
+        case GL_RG16F:
+        case GL_R32F:
+        case GL_DEPTH_COMPONENT:
+        case GL_DEPTH_COMPONENT32F:
+        case GL_DEPTH24_STENCIL8:
+            return 4;
+        case GL_RGB16F:
+            return 6;
+        case GL_RGBA16F:
+        case GL_RGBA16_SNORM:
+        case GL_RG32F:
+        case GL_DEPTH32F_STENCIL8:
+            return 8;
+        case GL_RGB32F:
+            return 12;
+        case GL_RGBA32F:
+            return 16;
+        default: assert(false); return 4;
+    }
+}
+
+GpuMemory::State& GpuMemory::state() {
+    return leakedSingleton<State>();
+}
+
+void GpuMemory::checkBudget() {
+    State& s = state();
+    if (s.total > s.budget && !s.overBudget) {
+        std::cerr << "GPU memory budget exceeded: " << s.total / (1024 * 1024) << " MiB of " << s.budget / (1024 * 1024) << " MiB in use" << std::endl;
+    }
+    s.overBudget = s.total > s.budget;
+}
\ No newline at end of file
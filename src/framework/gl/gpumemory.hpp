@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Bookkeeping of GPU memory allocated through the Texture and Buffer wrappers
+ * Sizes are estimated from the internal format at allocation time, drivers may add padding
+ * Suballocators report their ranges, buffers of the same category are then listed by range plus what is unused
+ */
+class GpuMemory {
+   public:
+    enum class Object {
+        TEXTURE,
+        BUFFER,
+    };
+    struct Allocation {
+        std::string category;
+        std::string name;
+        size_t bytes = 0;
+    };
+
+    static void track(Object object, GLuint handle, size_t bytes);
+    static void untrack(Object object, GLuint handle);
+    static void label(Object object, GLuint handle, const std::string& category, const std::string& name);
+    // key is chosen by the suballocator, ranges only change the attribution and not the total
+    static void trackRange(uint64_t key, const std::string& category, size_t bytes);
+    static void labelRange(uint64_t key, const std::string& name);
+    static void untrackRange(uint64_t key);
+
+    static size_t getTotal();
+    static std::map<std::string, size_t> getCategoryTotals();
+    static std::vector<Allocation> getAllocations();
+
+    static void setBudget(size_t bytes);
+    static size_t getBudget();
+
+    static size_t bytesPerPixel(GLenum internalformat);
+
+   private:
+    struct State {
+        std::map<std::pair<Object, GLuint>, Allocation> allocations;
+        std::map<uint64_t, Allocation> ranges;
+        size_t total = 0;
+        size_t budget = SIZE_MAX;
+        bool overBudget = false;
+    };
+
+    static State& state();
+    static void checkBudget();
+};
\ No newline at end of file
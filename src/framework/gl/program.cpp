@@ -4,11 +4,20 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
 #include <vector>
 #include <stdexcept>
 #include <string>
 
+#include "common.hpp"
+#include "config.hpp"
+#include "glstate.hpp"
 #include "shader.hpp"
 
 using namespace glm;
@@ -19,15 +28,30 @@ Program::Program() {
     assert(handle);
 }
 
-Program::Program(Program&& other) : handle(other.handle) {
+Program::Program(Program&& other)
+    : handle(other.handle),
+      uniforms(std::move(other.uniforms)),
+      uniformBlocks(std::move(other.uniformBlocks)),
+      slotLocations(std::move(other.slotLocations)),
+      pending(other.pending),
+      name(std::move(other.name)),
+      binaryFile(std::move(other.binaryFile)) {
     other.handle = 0;
+    other.pending = false;
 }
 
 Program& Program::operator=(Program&& other) {
     if (this != &other) {
         release();
         handle = other.handle;
+        uniforms = std::move(other.uniforms);
+        uniformBlocks = std::move(other.uniformBlocks);
+        slotLocations = std::move(other.slotLocations);
+        pending = other.pending;
+        name = std::move(other.name);
+        binaryFile = std::move(other.binaryFile);
         other.handle = 0;
+        other.pending = false;
     }
     return *this;
 }
@@ -37,21 +61,171 @@ Program::~Program() {
 }
 
 void Program::release() {
-    if (handle) glDeleteProgram(handle);
+    if (handle) {
+        GLState::forget(GLState::Category::PROGRAM, handle);
+        glDeleteProgram(handle);
+    }
 }
 /////////////////////////////////////////////////////////////
 
 void Program::load(const std::string& vs, const std::string& fs) {
-    attach(vs, Shader::Type::VERTEX_SHADER);
-    attach(fs, Shader::Type::FRAGMENT_SHADER);
-    link();
+    load({{Shader::Type::VERTEX_SHADER, vs}, {Shader::Type::FRAGMENT_SHADER, fs}});
 }
 
 void Program::load(const std::string& vs, const std::string& gs, const std::string& fs) {
-    attach(vs, Shader::Type::VERTEX_SHADER);
-    attach(gs, Shader::Type::GEOMETRY_SHADER);
-    attach(fs, Shader::Type::FRAGMENT_SHADER);
-    link();
+    load({{Shader::Type::VERTEX_SHADER, vs}, {Shader::Type::GEOMETRY_SHADER, gs}, {Shader::Type::FRAGMENT_SHADER, fs}});
+}
+
+void Program::load(const std::string& vs, const std::string& fs, const std::vector<std::string>& defines) {
+    load({{Shader::Type::VERTEX_SHADER, vs}, {Shader::Type::FRAGMENT_SHADER, fs}}, defines);
+}
+
+static std::string glString(GLenum name) {
+    const GLubyte* string = glGetString(name);
+    return string ? reinterpret_cast<const char*>(string) : "";
+}
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+static bool hasParallelCompile() {
+    static const bool supported = [] {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const GLubyte* extension = glGetStringi(GL_EXTENSIONS, i);
+            if (extension && std::string(reinterpret_cast<const char*>(extension)) == "GL_KHR_parallel_shader_compile") {
+#ifdef GL_KHR_parallel_shader_compile
+                // let the driver choose the number of compiler threads
+                if (glad_glMaxShaderCompilerThreadsKHR) glad_glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+#endif
+                return true;
+            }
+        }
+        return false;
+    }();
+    return supported;
+}
+
+void Program::load(const std::vector<std::pair<Shader::Type, std::string>>& stages, const std::vector<std::string>& defines) {
+    std::vector<ShaderPreprocessor::Result> sources;
+    for (const auto& [type, filename] : stages) {
+        sources.push_back(Shader::read(filename, defines));
+    }
+
+    // Binaries are only valid for the driver that created them
+    uint64_t hash = Common::fnv1a(glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION));
+    for (size_t i = 0; i < stages.size(); i++) {
+        hash = Common::fnv1a(std::to_string(static_cast<GLenum>(stages[i].first)) + '\n', hash);
+        hash = Common::fnv1a(sources[i].source, hash);
+    }
+
+    std::stringstream cacheFile;
+    cacheFile << Config::SHADER_CACHE_DIR << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+
+    name.clear();
+    for (const auto& [type, filename] : stages) {
+        name += (name.empty() ? "" : ", ") + filename;
+    }
+
+    if (loadBinary(cacheFile.str())) return;
+
+    // Only submit the work here, the status is checked in finish() so the driver can compile in the background
+    hasParallelCompile();
+    for (size_t i = 0; i < stages.size(); i++) {
+        Shader shader(stages[i].first);
+        shader.submit(sources[i].source, sources[i].files);
+        attach(std::move(shader));
+    }
+
+    glProgramParameteri(handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(handle);
+    pending = true;
+    binaryFile = cacheFile.str();
+}
+
+bool Program::isReady() {
+    if (!pending) return true;
+    // Without the extension completion can't be polled, waiting once is better than never becoming ready
+    if (!hasParallelCompile()) {
+        finish();
+        return true;
+    }
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(handle, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+void Program::finish() {
+    if (!pending) return;
+    pending = false;
+
+    int success;
+    glGetProgramiv(handle, GL_LINK_STATUS, &success);
+    if (!success) {
+        // a failed compile is the more useful message
+        for (Shader& shader : shaders) {
+            try {
+                shader.checkStatus();
+            } catch (const std::runtime_error& e) {
+                throw std::runtime_error(name + ": " + e.what());
+            }
+        }
+
+        char infoLog[512];
+        glGetProgramInfoLog(handle, 512, NULL, infoLog);
+        throw std::runtime_error(name + ": Program linking failed: " + std::string(infoLog));
+    }
+
+    reflect();
+    saveBinary(binaryFile);
+}
+
+bool Program::loadBinary(const std::string& filename) {
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0) return false;
+
+    std::ifstream stream(filename, std::ios::binary);
+    if (!stream.is_open()) return false;
+
+    GLenum format;
+    if (!stream.read(reinterpret_cast<char*>(&format), sizeof(format))) return false;
+    // reading through the stream buffer leaves the stream state alone, an empty binary means a truncated file
+    std::vector<char> binary((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    if (binary.empty()) return false;
+
+    glProgramBinary(handle, format, binary.data(), binary.size());
+
+    // A driver update can reject old binaries, the program is then compiled from source again
+    int success;
+    glGetProgramiv(handle, GL_LINK_STATUS, &success);
+    if (!success) {
+        std::cerr << "Program binary " << filename << " rejected, recompiling" << std::endl;
+        return false;
+    }
+    reflect();
+    return true;
+}
+
+void Program::saveBinary(const std::string& filename) {
+    GLint length = 0;
+    glGetProgramiv(handle, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length == 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(handle, length, NULL, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+
+    std::ofstream stream(filename, std::ios::binary);
+    if (!stream.is_open()) return;
+    stream.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    stream.write(binary.data(), binary.size());
 }
 
 void Program::attach(Shader shader) {
@@ -75,31 +249,125 @@ void Program::link() {
         glGetProgramInfoLog(handle, 512, NULL, infoLog);
         throw std::runtime_error("Program linking failed: " + std::string(infoLog));
     }
+    reflect();
 }
 
 void Program::bind() {
-    glUseProgram(handle);
+    finish();
+    GLState::useProgram(handle);
 }
 
-GLuint Program::uniform(const std::string& name) {
-    if (uniformLocationCache.find(name) != uniformLocationCache.end()) {
-        return uniformLocationCache[name];
-    }
+GLuint Program::uniform(UniformName name) {
+    finish();
+
+    auto it = std::lower_bound(uniforms.begin(), uniforms.end(), name.hash, [](const UniformInfo& info, uint64_t hash) { return info.hash < hash; });
+    // -1 like glGetUniformLocation, setting it is silently ignored
+    return it != uniforms.end() && it->hash == name.hash ? it->location : -1;
+}
 
-    GLint location = glGetUniformLocation(handle, name.c_str());
+// -1 is a valid result of uniform(), unresolved slots are marked below it
+static constexpr GLint UNRESOLVED_SLOT = -2;
 
-    uniformLocationCache[name] = location;
+GLuint Program::uniform(const UniformSlot& slot) {
+    // before indexing, reflecting a pending program clears the slots
+    finish();
 
+    if (slot.index >= slotLocations.size()) {
+        slotLocations.resize(slot.index + 1, UNRESOLVED_SLOT);
+    }
+
+    GLint& location = slotLocations[slot.index];
+    if (location == UNRESOLVED_SLOT) location = static_cast<GLint>(uniform(slot.name));
     return location;
 }
 
-void Program::bindUBO(const std::string& loc, GLuint index) {
-    GLuint i = glGetUniformBlockIndex(handle, loc.c_str());
-    glUniformBlockBinding(handle, i, index);
+void Program::bindUBO(UniformName name, GLuint index) {
+    finish();
+
+    auto it = std::lower_bound(uniformBlocks.begin(), uniformBlocks.end(), name.hash, [](const UniformBlockInfo& info, uint64_t hash) { return info.hash < hash; });
+    if (it != uniformBlocks.end() && it->hash == name.hash) {
+        glUniformBlockBinding(handle, it->index, index);
+    }
 }
 
-void Program::bindTextureUnit(const std::string& loc, GLint index) {
-    set(uniform(loc), index);
+void Program::bindTextureUnit(UniformName name, GLint index) {
+    set(uniform(name), index);
+}
+
+// GLSL 330 has no layout(binding), blocks are bound by name after linking
+static std::vector<std::pair<uint64_t, GLuint>> blockBindings;
+
+void Program::setBlockBinding(UniformName name, GLuint index) {
+    for (auto& [hash, binding] : blockBindings) {
+        if (hash == name.hash) {
+            binding = index;
+            return;
+        }
+    }
+    blockBindings.emplace_back(name.hash, index);
+}
+
+void Program::reflect() {
+    uniforms.clear();
+    uniformBlocks.clear();
+    slotLocations.clear();
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(handle, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> buffer(std::max(maxLength, 1));
+
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(handle, i, buffer.size(), &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+
+        // arrays are reported as "name[0]", register the plain name and every element
+        bool isArray = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0;
+        if (isArray) name.resize(name.size() - 3);
+
+        GLint location = glGetUniformLocation(handle, name.c_str());
+        if (location == -1) continue; // member of a uniform block
+
+        uniforms.push_back({Common::fnv1a(name), name, location, type, size});
+        for (GLint element = 0; isArray && element < size; element++) {
+            std::string elementName = name + "[" + std::to_string(element) + "]";
+            uniforms.push_back({Common::fnv1a(elementName), elementName, glGetUniformLocation(handle, elementName.c_str()), type, 1});
+        }
+    }
+
+    glGetProgramiv(handle, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    glGetProgramiv(handle, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+    buffer.resize(std::max(maxLength, 1));
+
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        glGetActiveUniformBlockName(handle, i, buffer.size(), &length, buffer.data());
+        glGetActiveUniformBlockiv(handle, i, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+        std::string name(buffer.data(), length);
+
+        uniformBlocks.push_back({Common::fnv1a(name), name, static_cast<GLuint>(i), size});
+
+        for (const auto& [hash, binding] : blockBindings) {
+            if (hash == uniformBlocks.back().hash) glUniformBlockBinding(handle, i, binding);
+        }
+    }
+
+    std::sort(uniforms.begin(), uniforms.end(), [](const UniformInfo& a, const UniformInfo& b) { return a.hash < b.hash; });
+    std::sort(uniformBlocks.begin(), uniformBlocks.end(), [](const UniformBlockInfo& a, const UniformBlockInfo& b) { return a.hash < b.hash; });
+
+    auto checkCollisions = [](const auto& infos) {
+        for (size_t i = 1; i < infos.size(); i++) {
+            if (infos[i].hash == infos[i - 1].hash && infos[i].name != infos[i - 1].name) {
+                throw std::runtime_error("Uniform hash collision: " + infos[i - 1].name + ", " + infos[i].name);
+            }
+        }
+    };
+    checkCollisions(uniforms);
+    checkCollisions(uniformBlocks);
 }
 
 void Program::set(GLuint loc, GLint value) {
@@ -4,16 +4,38 @@
 
 #include <vector>
 #include <string>
-#include <unordered_map>
+#include <cstdint>
+#include <utility>
 
 #include "buffer.hpp"
 #include "shader.hpp"
+#include "uniformname.hpp"
 
 /**
  * RAII wrapper for OpenGL program
+ * Programs created through load() are cached as driver binaries in Config::SHADER_CACHE_DIR,
+ * keyed by the expanded sources and the driver, and only compiled when no matching binary exists.
+ * load() does not wait for the driver: the compile and link status is checked in finish(), which runs on first use,
+ * so all programs can be submitted up front and compile in parallel (GL_KHR_parallel_shader_compile) with asset loading
  */
 class Program {
 public:
+    // Active uniforms and blocks, reflected after linking and sorted by name hash
+    struct UniformInfo {
+        uint64_t hash;
+        std::string name;
+        GLint location;
+        GLenum type;
+        GLint size; // number of array elements
+    };
+
+    struct UniformBlockInfo {
+        uint64_t hash;
+        std::string name;
+        GLuint index;
+        GLint size; // in bytes
+    };
+
     Program();
     // Disable copying
     Program(const Program&) = delete;
@@ -24,13 +46,24 @@ public:
     ~Program();
     void load(const std::string& vs, const std::string& fs);
     void load(const std::string& vs, const std::string& gs, const std::string& fs);
+    // Every define is injected as "#define <define>" into all stages, see ProgramVariants
+    void load(const std::string& vs, const std::string& fs, const std::vector<std::string>& defines);
     void attach(Shader shader);
     void attach(const std::string& filename, Shader::Type type);
     void link();
+    // False while the driver is still compiling, blocks like finish() if completion can not be queried
+    bool isReady();
+    // Waits for a pending load() and throws on compile or link errors
+    void finish();
     void bind();
-    GLuint uniform(const std::string& name);
-    void bindUBO(const std::string& loc, GLuint index);
-    void bindTextureUnit(const std::string& loc, GLint index);
+    // Binary search in the reflected table, no string work for constexpr names
+    GLuint uniform(UniformName name);
+    // Resolved with uniform(name) on first use, an array access afterwards
+    GLuint uniform(const UniformSlot& slot);
+    void bindUBO(UniformName name, GLuint index);
+    void bindTextureUnit(UniformName name, GLint index);
+    // Uniform blocks with this name are bound to the binding point in every program linked afterwards
+    static void setBlockBinding(UniformName name, GLuint index);
     void set(GLuint loc, GLint value);
     void set(GLuint loc, GLuint value);
     void set(GLuint loc, GLfloat value);
@@ -47,19 +80,38 @@ public:
     void set(GLuint loc, const std::vector<glm::vec3>& values);
     void set(GLuint loc, const std::vector<glm::vec4>& values);
     template <typename T>
-    void set(const std::string& loc, const T& value);
+    void set(UniformName name, const T& value);
+    template <typename T>
+    void set(const UniformSlot& slot, const T& value);
+
+    const std::vector<UniformInfo>& getUniforms() const { return uniforms; }
+    const std::vector<UniformBlockInfo>& getUniformBlocks() const { return uniformBlocks; }
 
     GLuint handle;
     std::vector<Shader> shaders;
 
 private:
     void release();
+    void load(const std::vector<std::pair<Shader::Type, std::string>>& stages, const std::vector<std::string>& defines = {});
+    bool loadBinary(const std::string& filename);
+    void saveBinary(const std::string& filename);
+    void reflect();
 
 private:
-    std::unordered_map<std::string, GLint> uniformLocationCache;
+    std::vector<UniformInfo> uniforms;
+    std::vector<UniformBlockInfo> uniformBlocks;
+    std::vector<GLint> slotLocations; // by UniformSlot::index, UNRESOLVED_SLOT until first use
+    bool pending = false;
+    std::string name; // stage filenames for error messages
+    std::string binaryFile;
 };
 
 template <typename T>
-inline void Program::set(const std::string& loc, const T& value) {
-    Program::set(Program::uniform(loc), value);
+inline void Program::set(UniformName name, const T& value) {
+    Program::set(Program::uniform(name), value);
+}
+
+template <typename T>
+inline void Program::set(const UniformSlot& slot, const T& value) {
+    Program::set(Program::uniform(slot), value);
 }
\ No newline at end of file
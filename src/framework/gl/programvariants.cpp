@@ -0,0 +1,53 @@
+#include "programvariants.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+ProgramVariants::ProgramVariants(const std::string& vs, const std::string& fs, const std::vector<std::string>& features, const std::vector<std::string>& counts)
+    : vs(vs), fs(fs), features(features), counts(counts) {
+    if (features.size() > MAX_FEATURES) throw std::runtime_error("Too many program features: " + std::to_string(features.size()));
+    if (counts.size() > MAX_COUNTS) throw std::runtime_error("Too many program counts: " + std::to_string(counts.size()));
+}
+
+void ProgramVariants::setInitializer(std::function<void(Program&)> initializer) {
+    this->initializer = std::move(initializer);
+}
+
+uint64_t ProgramVariants::key(uint32_t features, const std::vector<unsigned int>& counts) const {
+    if (counts.size() != this->counts.size()) throw std::runtime_error("Expected " + std::to_string(this->counts.size()) + " program counts");
+
+    // feature bits in the low half, one byte per count in the high half
+    uint64_t key = features;
+    for (size_t i = 0; i < counts.size(); i++) {
+        if (counts[i] > 0xFF) throw std::runtime_error(this->counts[i] + " out of range: " + std::to_string(counts[i]));
+        key |= static_cast<uint64_t>(counts[i]) << (32 + 8 * i);
+    }
+    return key;
+}
+
+Program& ProgramVariants::get(uint32_t features, const std::vector<unsigned int>& counts) {
+    uint64_t variantKey = key(features, counts);
+
+    auto it = variants.find(variantKey);
+    if (it != variants.end()) return it->second;
+
+    std::vector<std::string> defines;
+    for (size_t i = 0; i < this->features.size(); i++) {
+        if (features & (1u << i)) defines.push_back(this->features[i]);
+    }
+    for (size_t i = 0; i < counts.size(); i++) {
+        defines.push_back(this->counts[i] + " " + std::to_string(counts[i]));
+    }
+
+    Program& program = variants[variantKey];
+    try {
+        program.load(vs, fs, defines);
+        if (initializer) initializer(program);
+    } catch (...) {
+        variants.erase(variantKey);
+        throw;
+    }
+    return program;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "program.hpp"
+
+/**
+ * Lazily compiled permutations of one program
+ * A variant is selected by a bit mask of features and a few small counts. Each set feature bit is compiled in as
+ * "#define <feature>", each count as "#define <count> <value>", so shaders can drop branches and loops at compile time.
+ * Variants are compiled on first request and cached by their key.
+ */
+class ProgramVariants {
+   public:
+    static constexpr size_t MAX_FEATURES = 32;
+    static constexpr size_t MAX_COUNTS = 4; // each count has to be below 256
+
+    ProgramVariants(const std::string& vs, const std::string& fs, const std::vector<std::string>& features, const std::vector<std::string>& counts = {});
+    // Disable copying, handed out programs are referenced
+    ProgramVariants(const ProgramVariants&) = delete;
+    ProgramVariants& operator=(const ProgramVariants&) = delete;
+
+    // Called once for every new variant, e.g. to bind texture units
+    void setInitializer(std::function<void(Program&)> initializer);
+
+    uint64_t key(uint32_t features, const std::vector<unsigned int>& counts = {}) const;
+    Program& get(uint32_t features, const std::vector<unsigned int>& counts = {});
+    size_t size() const { return variants.size(); }
+
+   private:
+    std::string vs;
+    std::string fs;
+    std::vector<std::string> features;
+    std::vector<std::string> counts;
+    std::function<void(Program&)> initializer;
+
+    std::unordered_map<uint64_t, Program> variants; // nodes are stable, references stay valid
+};
\ No newline at end of file
@@ -34,9 +34,26 @@ void Query::begin(Type type) {
     glBeginQuery(static_cast<GLenum>(type), handle);
 }
 
-GLuint Query::end(Type type) {
+void Query::end(Type type) {
     glEndQuery(static_cast<GLenum>(type));
+}
+
+bool Query::isAvailable() const {
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(handle, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available == GL_TRUE;
+}
+
+GLuint Query::getResult() const {
     GLuint result;
     glGetQueryObjectuiv(handle, GL_QUERY_RESULT, &result);
     return result;
+}
+
+void Query::beginConditionalRender(Wait mode) const {
+    glBeginConditionalRender(handle, static_cast<GLenum>(mode));
+}
+
+void Query::endConditionalRender() {
+    glEndConditionalRender();
 }
\ No newline at end of file
@@ -9,6 +9,16 @@ class Query {
    public:
     enum class Type {
         TIME_ELAPSED = GL_TIME_ELAPSED,
+        SAMPLES_PASSED = GL_SAMPLES_PASSED,
+        ANY_SAMPLES_PASSED = GL_ANY_SAMPLES_PASSED,
+    };
+
+    // How conditional rendering treats a query whose result is not available yet
+    enum class Wait {
+        WAIT = GL_QUERY_WAIT,
+        NO_WAIT = GL_QUERY_NO_WAIT, // renders as if samples passed
+        BY_REGION_WAIT = GL_QUERY_BY_REGION_WAIT,
+        BY_REGION_NO_WAIT = GL_QUERY_BY_REGION_NO_WAIT,
     };
     
     Query();
@@ -20,7 +30,16 @@ class Query {
     Query& operator=(Query&& other);
     ~Query();
     void begin(Type type);
-    GLuint end(Type type);
+    // Does not wait for the result, poll isAvailable() in a later frame
+    void end(Type type);
+
+    bool isAvailable() const;
+    // Blocks until the GPU has finished the query
+    GLuint getResult() const;
+
+    // Draws until endConditionalRender() are discarded by the GPU if no samples passed this query
+    void beginConditionalRender(Wait mode) const;
+    static void endConditionalRender();
 
     GLuint handle;
 
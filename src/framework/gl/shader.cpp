@@ -3,10 +3,10 @@
 #include <glad/glad.h>
 
 #include <cassert>
-#include <regex>
-#include <set>
 #include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common.hpp"
 #include "config.hpp"
@@ -17,7 +17,7 @@ Shader::Shader(Type type) {
     assert(handle);
 }
 
-Shader::Shader(Shader&& other) : handle(other.handle) {
+Shader::Shader(Shader&& other) : handle(other.handle), files(std::move(other.files)) {
     other.handle = 0;
 }
 
@@ -25,6 +25,7 @@ Shader& Shader::operator=(Shader&& other) {
     if (this != &other) {
         release();
         handle = other.handle;
+        files = std::move(other.files);
         other.handle = 0;
     }
     return *this;
@@ -39,45 +40,49 @@ void Shader::release() {
 }
 /////////////////////////////////////////////////////////////
 
-const std::regex includeRegex("(?:^|\n)#include \"([^\"]+)\"");
-
-std::string readShader(const std::string& filename, std::set<std::string>& included) {
-    std::string source = Common::readFile(Config::SHADER_DIR + filename);
-    std::smatch match;
-    while (std::regex_search(source, match, includeRegex)) {
-        if (included.find(match[1].str()) == included.end()) {
-            included.insert(match[1].str());
-            try {
-                std::string include = readShader(match[1].str(), included);
-                source = match.prefix().str() + include + match.suffix().str();
-            } catch (const std::runtime_error& e) {
-                throw std::runtime_error("Error including \"" + match[1].str() + "\" in \"" + filename + "\": " + e.what());
-            }
-        } else {
-            source = match.prefix().str() + match.suffix().str();
-        }
-    }
-    return source;
+ShaderPreprocessor::Result Shader::read(const std::string& filename, const std::vector<std::string>& defines) {
+    ShaderPreprocessor::Result result = ShaderPreprocessor::process(filename, defines);
+#ifdef COMPOSE_SHADERS
+    Common::writeToFile(result.source, Config::COMPOSED_SHADER_DIR + filename);
+#endif
+    return result;
 }
 
 void Shader::load(const std::string& filename) {
-    std::set<std::string> included;
-    std::string source = readShader(filename, included);
-#ifdef COMPOSE_SHADERS
-    Common::writeToFile(source, Config::COMPOSED_SHADER_DIR + filename);
-#endif
+    ShaderPreprocessor::Result result = read(filename);
+    loadSource(result.source, result.files);
+}
+
+void Shader::loadSource(const std::string& source, const std::vector<std::string>& files) {
+    this->files = files;
     const char* sourcePtr = source.c_str();
     glShaderSource(handle, 1, &sourcePtr, NULL);
     compile();
 }
 
+void Shader::submit(const std::string& source, const std::vector<std::string>& files) {
+    this->files = files;
+    const char* sourcePtr = source.c_str();
+    glShaderSource(handle, 1, &sourcePtr, NULL);
+    glCompileShader(handle);
+}
+
 void Shader::compile() {
     glCompileShader(handle);
+    checkStatus();
+}
+
+void Shader::checkStatus() {
     int success;
     glGetShaderiv(handle, GL_COMPILE_STATUS, &success);
     if (!success) {
         char infoLog[512];
         glGetShaderInfoLog(handle, 512, NULL, infoLog);
-        throw std::runtime_error("Shader compilation failed: " + std::string(infoLog));
+        std::string message = "Shader compilation failed: " + std::string(infoLog);
+        // resolve the source string numbers of the #line directives
+        for (size_t i = 0; i < files.size(); i++) {
+            message += "\n  " + std::to_string(i) + ": " + files[i];
+        }
+        throw std::runtime_error(message);
     }
 }
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include <glm/glm.hpp>
 
 #include <string>
+#include <vector>
+
+#include "shaderpreprocessor.hpp"
 
 class Shader {
    public:
@@ -22,10 +25,19 @@ class Shader {
     Shader& operator=(Shader&& other);
     ~Shader();
     void load(const std::string& filename);
+    void loadSource(const std::string& source, const std::vector<std::string>& files = {});
     void compile();
+    // Starts compiling without waiting for the driver, checkStatus() reports errors later
+    void submit(const std::string& source, const std::vector<std::string>& files = {});
+    void checkStatus();
+
+    // Source with all includes expanded and the defines injected
+    static ShaderPreprocessor::Result read(const std::string& filename, const std::vector<std::string>& defines = {});
 
     GLuint handle;
 
    private:
+    std::vector<std::string> files; // source string numbers for compile errors
+
     void release();
 };
\ No newline at end of file
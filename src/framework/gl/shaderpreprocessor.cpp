@@ -0,0 +1,106 @@
+#include "shaderpreprocessor.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "config.hpp"
+#include "embeddedshaders.hpp"
+
+std::unordered_map<std::string, ShaderPreprocessor::CachedFile> ShaderPreprocessor::cache;
+
+ShaderPreprocessor::Result ShaderPreprocessor::process(const std::string& filename, const std::vector<std::string>& defines) {
+#ifdef SHADERS_FROM_DISK
+    Config::setWorkingDirectory();
+#endif
+
+    Result result;
+    std::unordered_set<std::string> included = {filename};
+    expand(filename, defines, result, included);
+    return result;
+}
+
+void ShaderPreprocessor::clearCache() {
+    cache.clear();
+}
+
+std::string_view ShaderPreprocessor::read(const std::string& filename) {
+#ifdef SHADERS_FROM_DISK
+    std::filesystem::path path{Config::SHADER_DIR + filename};
+    std::error_code error;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+
+    auto it = cache.find(filename);
+    if (it != cache.end() && !error && it->second.time == time) return it->second.source;
+
+    std::ifstream stream{path, std::ios::binary};
+    if (!stream.is_open()) throw std::runtime_error("Could not open file: " + std::filesystem::absolute(path).string());
+    std::stringstream buffer;
+    buffer << stream.rdbuf();
+
+    CachedFile& file = cache[filename];
+    file.source = buffer.str();
+    file.time = time;
+    return file.source;
+#else
+    const EmbeddedShaders::Entry* entry = EmbeddedShaders::find(filename);
+    if (!entry) throw std::runtime_error("No embedded shader: " + filename);
+    return entry->source;
+#endif
+}
+
+static bool startsWith(std::string_view line, std::string_view prefix) {
+    return line.substr(0, prefix.size()) == prefix;
+}
+
+void ShaderPreprocessor::expand(const std::string& filename, const std::vector<std::string>& defines, Result& result, std::unordered_set<std::string>& included) {
+    std::string_view source = read(filename);
+    const std::string fileIndex = std::to_string(result.files.size());
+    result.files.push_back(filename);
+    result.source.reserve(result.source.size() + source.size());
+
+    std::string_view remaining{source};
+    size_t lineNumber = 0;
+
+    while (!remaining.empty()) {
+        size_t end = remaining.find('\n');
+        std::string_view line = remaining.substr(0, end);
+        remaining = end == std::string_view::npos ? std::string_view() : remaining.substr(end + 1);
+        lineNumber++;
+
+        if (startsWith(line, "#version")) {
+            result.source.append(line).append("\n");
+
+            // defines go directly after #version, which has to stay the first statement
+            if (!defines.empty()) {
+                for (const std::string& define : defines) {
+                    result.source.append("#define ").append(define).append("\n");
+                }
+                result.source.append("#line ").append(std::to_string(lineNumber + 1)).append(" ").append(fileIndex).append("\n");
+            }
+        } else if (startsWith(line, "#include")) {
+            size_t first = line.find('"');
+            size_t last = line.rfind('"');
+            if (first == std::string_view::npos || first == last) {
+                throw std::runtime_error("Malformed include in \"" + filename + "\" line " + std::to_string(lineNumber));
+            }
+
+            std::string include{line.substr(first + 1, last - first - 1)};
+            if (!included.insert(include).second) continue;
+
+            try {
+                result.source.append("#line 1 ").append(std::to_string(result.files.size())).append("\n");
+                expand(include, {}, result, included);
+                result.source.append("#line ").append(std::to_string(lineNumber + 1)).append(" ").append(fileIndex).append("\n");
+            } catch (const std::runtime_error& e) {
+                throw std::runtime_error("Error including \"" + include + "\" in \"" + filename + "\": " + e.what());
+            }
+        } else {
+            result.source.append(line).append("\n");
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Single pass GLSL preprocessor for shader composition
+ * Expands #include "file" (every file at most once), injects #defines after the #version line and emits
+ * #line directives so compiler messages point into the original files. Sources come from the table embedded at
+ * build time; with SHADERS_FROM_DISK they are read from disk instead, cached and only read again after they changed.
+ */
+class ShaderPreprocessor {
+   public:
+    struct Result {
+        std::string source;
+        std::vector<std::string> files; // source string numbers used in #line, 0 is the root file
+    };
+
+    // defines are given as "NAME" or "NAME VALUE"
+    static Result process(const std::string& filename, const std::vector<std::string>& defines = {});
+    static void clearCache();
+
+   private:
+    struct CachedFile {
+        std::string source;
+        std::filesystem::file_time_type time;
+    };
+
+    // embedded source, or the file in Config::SHADER_DIR with SHADERS_FROM_DISK
+    static std::string_view read(const std::string& filename);
+    static void expand(const std::string& filename, const std::vector<std::string>& defines, Result& result, std::unordered_set<std::string>& included);
+
+    static std::unordered_map<std::string, CachedFile> cache;
+};
\ No newline at end of file
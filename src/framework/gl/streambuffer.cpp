@@ -0,0 +1,160 @@
+#include "streambuffer.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+static const size_t MIN_REGION_SIZE = 1 << 16;
+
+static uint64_t& currentFrame() {
+    static uint64_t frame = 1;
+    return frame;
+}
+
+/////////////////////// RAII behavior ///////////////////////
+StreamBuffer::StreamBuffer(size_t regionSize) : regionSize(regionSize) {}
+
+StreamBuffer::StreamBuffer(StreamBuffer&& other)
+    : buffer(std::move(other.buffer)),
+      mapped(std::exchange(other.mapped, nullptr)),
+      regionSize(std::exchange(other.regionSize, 0)),
+      region(other.region),
+      head(other.head),
+      frame(other.frame),
+      stalls(other.stalls),
+      fences(std::exchange(other.fences, {})),
+      category(std::move(other.category)),
+      name(std::move(other.name)) {}
+
+StreamBuffer& StreamBuffer::operator=(StreamBuffer&& other) {
+    if (this != &other) {
+        release();
+        buffer = std::move(other.buffer);
+        mapped = std::exchange(other.mapped, nullptr);
+        regionSize = std::exchange(other.regionSize, 0);
+        region = other.region;
+        head = other.head;
+        frame = other.frame;
+        stalls = other.stalls;
+        fences = std::exchange(other.fences, {});
+        category = std::move(other.category);
+        name = std::move(other.name);
+    }
+    return *this;
+}
+
+StreamBuffer::~StreamBuffer() {
+    release();
+}
+
+void StreamBuffer::release() {
+    for (GLsync& fence : fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    // deleting the buffer also unmaps it
+    mapped = nullptr;
+}
+/////////////////////////////////////////////////////////////
+
+bool StreamBuffer::hasPersistentMapping() {
+    static const bool supported = [] {
+#if defined(GL_VERSION_4_4) && defined(GL_ARB_buffer_storage)
+        return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+#elif defined(GL_VERSION_4_4)
+        return GLAD_GL_VERSION_4_4 != 0;
+#else
+        return false;
+#endif
+    }();
+    return supported;
+}
+
+void StreamBuffer::nextFrame() {
+    currentFrame()++;
+}
+
+void StreamBuffer::label(const std::string& category, const std::string& name) {
+    this->category = category;
+    this->name = name;
+    if (regionSize > 0) buffer.label(category, name);
+}
+
+void StreamBuffer::advance() {
+    frame = currentFrame();
+
+    if (hasPersistentMapping()) {
+        // the commands of the last frame that wrote here have all been issued now
+        if (fences[region]) glDeleteSync(fences[region]);
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        region = (region + 1) % REGIONS;
+
+        if (GLsync fence = std::exchange(fences[region], nullptr)) {
+            GLenum result = glClientWaitSync(fence, 0, 0);
+            if (result == GL_TIMEOUT_EXPIRED) {
+                stalls++;
+                do {
+                    result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+                } while (result == GL_TIMEOUT_EXPIRED);
+            }
+            glDeleteSync(fence);
+        }
+    } else {
+        region = (region + 1) % REGIONS;
+
+        // orphaning hands the old storage to the driver, which keeps it until the GPU is done
+        if (region == 0) {
+            buffer.allocate(Buffer::Type::COPY_WRITE_BUFFER, REGIONS * regionSize, Buffer::Usage::STREAM_DRAW);
+        }
+    }
+
+    head = 0;
+}
+
+void StreamBuffer::reserve(size_t bytes) {
+    // a new buffer isn't used by the GPU yet, so all fences can be dropped
+    release();
+    regionSize = std::max({ 2 * regionSize, bytes, MIN_REGION_SIZE });
+    region = 0;
+    head = 0;
+    buffer = Buffer();
+
+    if (hasPersistentMapping()) {
+#ifdef GL_VERSION_4_4
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        buffer.storage(Buffer::Type::COPY_WRITE_BUFFER, REGIONS * regionSize, flags);
+        mapped = static_cast<char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, REGIONS * regionSize, flags));
+#endif
+    } else {
+        buffer.allocate(Buffer::Type::COPY_WRITE_BUFFER, REGIONS * regionSize, Buffer::Usage::STREAM_DRAW);
+    }
+
+    if (!category.empty()) buffer.label(category, name);
+}
+
+GLintptr StreamBuffer::write(const void* data, size_t bytes, size_t alignment) {
+    if (frame != currentFrame()) advance();
+
+    // alignments like sizeof(Instance) are not always powers of two
+    size_t start = region * regionSize;
+    size_t position = (start + head + alignment - 1) / alignment * alignment;
+    if (regionSize == 0 || position + bytes > start + regionSize) {
+        reserve(bytes);
+        start = position = 0;
+    }
+
+    if (mapped) {
+        std::memcpy(mapped + position, data, bytes);
+    } else if (bytes > 0) {
+        buffer.bind(Buffer::Type::COPY_WRITE_BUFFER);
+        void* target = glMapBufferRange(GL_COPY_WRITE_BUFFER, position, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        std::memcpy(target, data, bytes);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+
+    head = position + bytes - start;
+    return static_cast<GLintptr>(position);
+}
\ No newline at end of file
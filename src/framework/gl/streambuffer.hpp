@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "buffer.hpp"
+
+/**
+ * Ring buffer for data that is rewritten every frame
+ * The buffer is split into REGIONS regions, each frame writes into the next one. With persistent mapping the data
+ * is copied straight into coherent mapped memory and a fence per region makes sure the GPU is done with it before
+ * it is reused. Without buffer storage every write maps its range unsynchronized and the buffer is orphaned when
+ * the ring wraps around. Either way uploads never wait for draws that still read the previous frames.
+ */
+class StreamBuffer {
+   public:
+    static constexpr size_t REGIONS = 3;
+
+    explicit StreamBuffer(size_t regionSize = 0);
+    // Disable copying
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+    // Implement moving
+    StreamBuffer(StreamBuffer&& other);
+    StreamBuffer& operator=(StreamBuffer&& other);
+    ~StreamBuffer();
+
+    // Copies the data into the region of the current frame and returns its offset in bytes,
+    // the offset is a multiple of alignment. The buffer may be replaced by a larger one.
+    GLintptr write(const void* data, size_t bytes, size_t alignment = 4);
+    template <typename T>
+    GLintptr write(const std::vector<T>& data, size_t alignment = sizeof(T));
+
+    Buffer& getBuffer() { return buffer; }
+    size_t getStalls() const { return stalls; }
+    void label(const std::string& category, const std::string& name);
+
+    static bool hasPersistentMapping();
+    // Starts the next region in every stream buffer on its next write
+    static void nextFrame();
+
+   private:
+    void advance();
+    void reserve(size_t bytes);
+    void release();
+
+    Buffer buffer;
+    char* mapped = nullptr;
+    size_t regionSize = 0;
+    size_t region = 0;
+    size_t head = 0;
+    uint64_t frame = 0;
+    size_t stalls = 0; // writes that had to wait for the GPU
+    std::array<GLsync, REGIONS> fences = {};
+    std::string category, name;
+};
+
+template <typename T>
+inline GLintptr StreamBuffer::write(const std::vector<T>& data, size_t alignment) {
+    return write(data.data(), sizeof(T) * data.size(), alignment);
+}
\ No newline at end of file
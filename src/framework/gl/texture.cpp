@@ -8,6 +8,8 @@
 #include <stdexcept>
 
 #include "common.hpp"
+#include "glstate.hpp"
+#include "gpumemory.hpp"
 
 /////////////////////// RAII behavior ///////////////////////
 Texture::Texture() {
@@ -33,18 +35,21 @@ Texture::~Texture() {
 }
 
 void Texture::release() {
-    if (handle) glDeleteTextures(1, &handle);
+    if (handle) {
+        GpuMemory::untrack(GpuMemory::Object::TEXTURE, handle);
+        GLState::forget(GLState::Category::TEXTURE, handle);
+        glDeleteTextures(1, &handle);
+    }
 }
 /////////////////////////////////////////////////////////////
 
 void Texture::bind(Type type) {
-    glBindTexture(static_cast<GLenum>(type), handle);
+    GLState::bindTexture(static_cast<GLenum>(type), handle);
 }
 
 void Texture::bind(Type type, GLuint index) {
     // On OpenGL 4.5+ one would use the DSA version glBindTextureUnit
-    glActiveTexture(GL_TEXTURE0 + index);
-    glBindTexture(static_cast<GLenum>(type), handle);
+    GLState::bindTexture(static_cast<GLenum>(type), index, handle);
 }
 
 GLenum getInternalFormat(Texture::Format format, int channels) {
@@ -140,8 +145,8 @@ void Texture::load(Format format, const std::string& filename, GLsizei mipmaps)
 
     //auto rawfile = Common::readFile(filename);
 
-    // Load image from file and read format
-    stbi_set_flip_vertically_on_load(true);
+    // Load image from file and read format, the flag is per thread because loaders decode in parallel
+    stbi_set_flip_vertically_on_load_thread(true);
     switch (format) {
         case Format::LINEAR8:
         case Format::SRGB8:
@@ -178,6 +183,65 @@ void Texture::load(Format format, const std::string& filename, GLsizei mipmaps)
     // Free image data
     stbi_image_free(data);
 
-    // Generate mipmaps
-    if (mipmaps > 0) glGenerateMipmap(GL_TEXTURE_2D);
+    // Generate mipmaps, the full chain adds another third
+    size_t bytes = static_cast<size_t>(width) * height * GpuMemory::bytesPerPixel(internalformat);
+    if (mipmaps > 0) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        bytes += bytes / 3;
+    }
+    GpuMemory::track(GpuMemory::Object::TEXTURE, handle, bytes);
+}
+
+void Texture::load(Format format, const Image& image, GLsizei mipmaps) {
+    assert(format == Format::LINEAR8 || format == Format::SRGB8 || format == Format::NORMAL8);
+
+    allocate(Type::TEX2D, getInternalFormat(format, 4), image.width, image.height, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    if (mipmaps > 0) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        size_t bytes = static_cast<size_t>(image.width) * image.height * GpuMemory::bytesPerPixel(getInternalFormat(format, 4));
+        GpuMemory::track(GpuMemory::Object::TEXTURE, handle, bytes + bytes / 3);
+    }
+}
+
+void Texture::allocate(Type type, GLint internalformat, GLsizei width, GLsizei height, GLenum format, GLenum pixeltype, const void* data) {
+    bind(type);
+
+    size_t bytes = static_cast<size_t>(width) * height * GpuMemory::bytesPerPixel(internalformat);
+
+    if (type == Type::CUBE_MAP) {
+        for (GLenum face = 0; face < 6; face++) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, internalformat, width, height, 0, format, pixeltype, data);
+        }
+        bytes *= 6;
+    } else {
+        glTexImage2D(static_cast<GLenum>(type), 0, internalformat, width, height, 0, format, pixeltype, data);
+    }
+
+    GpuMemory::track(GpuMemory::Object::TEXTURE, handle, bytes);
+}
+
+void Texture::label(const std::string& category, const std::string& name) {
+    GpuMemory::label(GpuMemory::Object::TEXTURE, handle, category, name);
+}
+
+Texture::Image Texture::readImage(const std::string& filename) {
+    int width, height, channels;
+
+    stbi_set_flip_vertically_on_load_thread(true);
+    stbi_uc* data = stbi_load(filename.c_str(), &width, &height, &channels, 4);
+
+    if (!data) throw std::runtime_error("Failed to parse image: " + filename);
+
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(data, data + static_cast<size_t>(width) * height * 4);
+
+    stbi_image_free(data);
+
+    return image;
 }
\ No newline at end of file
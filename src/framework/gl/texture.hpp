@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 
 #include <string>
+#include <vector>
 
 /**
  * RAII wrapper for OpenGL texture
@@ -16,7 +17,8 @@ class Texture {
         TEX1D = GL_TEXTURE_1D,
         TEX2D = GL_TEXTURE_2D,
         TEX3D = GL_TEXTURE_3D,
-        CUBE_MAP = GL_TEXTURE_CUBE_MAP
+        CUBE_MAP = GL_TEXTURE_CUBE_MAP,
+        TEXTURE_BUFFER = GL_TEXTURE_BUFFER // storage comes from a Buffer, see glTexBuffer
     };
     enum class Format { // See https://www.khronos.org/opengl/wiki/Image_Format
         LINEAR8, // 8-bit unsigned normalized integer
@@ -26,6 +28,12 @@ class Texture {
         FLOAT32, // 32-bit floating point
         DEPTH32F_STENCIL8, // 32-bit floating point depth, 8-bit stencil
     };
+    /* CPU copy of an 8-bit RGBA image, rows start at the bottom like OpenGL textures */
+    struct Image {
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> pixels;
+    };
 
     Texture();
     // Disable copying
@@ -38,6 +46,12 @@ class Texture {
     void bind(Type type);
     void bind(Type type, GLuint index);
     void load(Format format, const std::string& filename, GLsizei mipmaps);
+    void load(Format format, const Image& image, GLsizei mipmaps);
+    // Allocates (and optionally fills) level 0, cube maps get all six faces
+    void allocate(Type type, GLint internalformat, GLsizei width, GLsizei height, GLenum format, GLenum pixeltype, const void* data = nullptr);
+    // Category and name under which the memory shows up in GpuMemory
+    void label(const std::string& category, const std::string& name);
+    static Image readImage(const std::string& filename);
 
     GLuint handle;
 
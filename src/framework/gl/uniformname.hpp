@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "common.hpp"
+
+/**
+ * Uniform or uniform block name reduced to its FNV-1a hash
+ * Declared constexpr the literal is guaranteed to be hashed at compile time, e.g. constexpr UniformName U_CAM_POS("uCamPos"),
+ * and Program looks the hash up in the table it reflected at link time.
+ */
+struct UniformName {
+    uint64_t hash;
+
+    constexpr UniformName(std::string_view name) : hash(Common::fnv1a(name)) {}
+    constexpr UniformName(const char* name) : UniformName(std::string_view(name)) {}
+    UniformName(const std::string& name) : UniformName(std::string_view(name)) {}
+
+    // Hash of "array[index]" or "array[index].member" without building the string
+    static constexpr UniformName element(std::string_view array, size_t index, std::string_view member = {});
+
+    constexpr bool operator==(const UniformName& other) const { return hash == other.hash; }
+
+   private:
+    constexpr explicit UniformName(uint64_t hash) : hash(hash) {}
+};
+
+constexpr UniformName UniformName::element(std::string_view array, size_t index, std::string_view member) {
+    char digits[20] = {};
+    size_t count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + index % 10);
+        index /= 10;
+    } while (index > 0);
+
+    uint64_t hash = Common::fnv1a("[", Common::fnv1a(array));
+    while (count > 0) {
+        hash = Common::fnv1a(std::string_view(&digits[--count], 1), hash);
+    }
+    hash = Common::fnv1a("]", hash);
+    if (!member.empty()) hash = Common::fnv1a(member, Common::fnv1a(".", hash));
+    return UniformName(hash);
+}
+
+/**
+ * Uniform name with a process wide index for per draw call sites, e.g. static const UniformSlot U_MODEL("uModel").
+ * Program resolves the location of a slot once and looks it up by the index afterwards.
+ */
+struct UniformSlot {
+    UniformName name;
+    uint32_t index;
+
+    explicit UniformSlot(UniformName name) : name(name), index(count().fetch_add(1, std::memory_order_relaxed)) {}
+
+   private:
+    static std::atomic<uint32_t>& count() {
+        static std::atomic<uint32_t> value(0);
+        return value;
+    }
+};
\ No newline at end of file
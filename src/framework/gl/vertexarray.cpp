@@ -4,6 +4,8 @@
 
 #include <cassert>
 
+#include "glstate.hpp"
+
 /////////////////////// RAII behavior ///////////////////////
 VertexArray::VertexArray() {
     glGenVertexArrays(1, &handle);
@@ -28,14 +30,17 @@ VertexArray::~VertexArray() {
 }
 
 void VertexArray::release() {
-    if (handle) glDeleteVertexArrays(1, &handle);
+    if (handle) {
+        GLState::forget(GLState::Category::VERTEX_ARRAY, handle);
+        glDeleteVertexArrays(1, &handle);
+    }
 }
 /////////////////////////////////////////////////////////////
 
 void VertexArray::bind() {
-    glBindVertexArray(handle);
+    GLState::bindVertexArray(handle);
 }
 
 void VertexArray::unbind() {
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
 }
\ No newline at end of file
@@ -9,7 +9,10 @@
 #include <vector>
 
 #include "config.hpp"
+#include "framework/bufferheap.hpp"
+#include "framework/geometryarena.hpp"
 #include "framework/series.hpp"
+#include "framework/gl/gpumemory.hpp"
 
 using namespace glm;
 
@@ -26,6 +29,43 @@ void ImGui::StatisticsWindow(float frametime, const vec2& resolution) {
     ImGui::End();
 }
 
+void ImGui::GpuMemoryWindow() {
+    const float MIB = 1024.0f * 1024.0f;
+
+    ImGui::Begin("GPU memory", NULL, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings);
+    if (GpuMemory::getTotal() > GpuMemory::getBudget()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%.1f MiB / %.1f MiB (over budget)", GpuMemory::getTotal() / MIB, GpuMemory::getBudget() / MIB);
+    } else {
+        ImGui::Text("%.1f MiB / %.1f MiB", GpuMemory::getTotal() / MIB, GpuMemory::getBudget() / MIB);
+    }
+    ImGui::Separator();
+    for (const auto& [category, bytes] : GpuMemory::getCategoryTotals()) {
+        if (ImGui::TreeNode(category.c_str(), "%s: %.2f MiB", category.c_str(), bytes / MIB)) {
+            for (const GpuMemory::Allocation& allocation : GpuMemory::getAllocations()) {
+                if (allocation.category != category) continue;
+                ImGui::Text("%s: %.2f MiB", allocation.name.empty() ? "(unnamed)" : allocation.name.c_str(), allocation.bytes / MIB);
+            }
+            ImGui::TreePop();
+        }
+    }
+
+    ImGui::SeparatorText("Suballocators");
+    auto rangeStats = [](const char* name, const RangeAllocator::Stats& stats, const char* unit) {
+        if (stats.capacity == 0) return;
+        ImGui::Text("%s: %zu / %zu %s in %zu ranges", name, stats.used, stats.capacity, unit, stats.allocations);
+        ImGui::Text("    %zu free blocks, largest %zu, %.0f%% fragmented", stats.freeRanges, stats.largestFree, 100.0f * stats.fragmentation());
+    };
+    for (size_t i = 0; i < static_cast<size_t>(GeometryArena::Format::COUNT); i++) {
+        GeometryArena::Format format = static_cast<GeometryArena::Format>(i);
+        rangeStats(GeometryArena::getName(format), GeometryArena::getVertexStats(format), "vertices");
+    }
+    rangeStats("Indices", GeometryArena::getIndexStats(), "indices");
+    BufferHeap::Stats heap = BufferHeap::getStats();
+    ImGui::Text("Buffer heap: %zu pages", heap.pages);
+    rangeStats("Heap", heap.ranges, "bytes");
+    ImGui::End();
+}
+
 bool ImGui::SphericalSlider(const char* label, vec3& cart) {
     vec2 sph = vec2(asin(cart.y), atan(cart.x, cart.z));
     ImGui::PushID(label);
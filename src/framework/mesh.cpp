@@ -11,112 +11,272 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <vector>
 #include <iostream>
 
 using namespace glm;
 
-void Mesh::load(const std::vector<float>& vertices, const std::vector<unsigned int>& indices) {
-    numIndices = indices.size();
-    vbo.load(Buffer::Type::ARRAY_BUFFER, vertices);
-    ebo.load(Buffer::Type::INDEX_BUFFER, indices);
+Mesh::Mesh(Mesh&& other)
+    : numIndices(other.numIndices), bounds(other.bounds), meshlets(std::move(other.meshlets)), geometry(other.geometry) {
+    other.numIndices = 0;
+    other.geometry = GeometryArena::Allocation();
+}
 
-    vao.bind();
-    vbo.bind(Buffer::Type::ARRAY_BUFFER);
-    ebo.bind(Buffer::Type::INDEX_BUFFER);
+Mesh& Mesh::operator=(Mesh&& other) {
+    if (this != &other) {
+        GeometryArena::free(geometry);
+        numIndices = other.numIndices;
+        bounds = other.bounds;
+        meshlets = std::move(other.meshlets);
+        geometry = other.geometry;
+        other.numIndices = 0;
+        other.geometry = GeometryArena::Allocation();
+    }
+    return *this;
+}
 
-    size_t stride = 3 * sizeof(float);
+Mesh::~Mesh() {
+    GeometryArena::free(geometry);
+}
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*) (0 * sizeof(float)));
-    glEnableVertexAttribArray(0);
+void Mesh::load(GeometryArena::Format format, const void* vertices, size_t vertexCount, size_t stride, const std::vector<unsigned int>& indices) {
+    GeometryArena::free(geometry);
+
+    bounds = Bounds();
+    for (size_t i = 0; i < vertexCount; i++) {
+        bounds.expand(*reinterpret_cast<const vec3*>(static_cast<const char*>(vertices) + i * stride));
+    }
+
+    numIndices = indices.size();
+    geometry = GeometryArena::allocate(format, vertices, vertexCount, indices);
+}
 
-    vao.unbind();
+void Mesh::label(const std::string& name) {
+    GeometryArena::label(geometry, name);
+}
+
+void Mesh::load(const std::vector<float>& vertices, const std::vector<unsigned int>& indices) {
+    load(GeometryArena::Format::P, vertices.data(), vertices.size() / 3, 3 * sizeof(float), indices);
 }
 
 void Mesh::load(const std::vector<VertexPCN>& vertices, const std::vector<unsigned int>& indices) {
-    numIndices = indices.size();
-    vbo.load(Buffer::Type::ARRAY_BUFFER, vertices);
-    ebo.load(Buffer::Type::INDEX_BUFFER, indices);
+    std::vector<vec3> positions(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        positions[i] = vertices[i].position;
+    }
+    buildMeshlets(positions, indices);
+
+    load(GeometryArena::Format::PCN, vertices.data(), vertices.size(), sizeof(VertexPCN), indices);
+}
+
+void Mesh::load(const std::vector<VertexPCNT>& vertices, const std::vector<unsigned int>& indices) {
+    std::vector<vec3> positions(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        positions[i] = vertices[i].position;
+    }
+    buildMeshlets(positions, indices);
 
-    vao.bind();
-    vbo.bind(Buffer::Type::ARRAY_BUFFER);
-    ebo.bind(Buffer::Type::INDEX_BUFFER);
+    load(GeometryArena::Format::PCNT, vertices.data(), vertices.size(), sizeof(VertexPCNT), indices);
+}
 
-    size_t stride = sizeof(VertexPCN);
+void Mesh::load(const std::vector<VertexPCNTB>& vertices, const std::vector<unsigned int>& indices) {
+    load(GeometryArena::Format::PCNTB, vertices.data(), vertices.size(), sizeof(VertexPCNTB), indices);
+}
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexPCNT, position));
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexPCNT, texCoord));
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexPCNT, normal));
+void Mesh::load(const std::string& filepath) {
+    std::vector<VertexPCNT> vertices;
+    std::vector<uint32_t> indices;
+    ObjParser::parse(filepath, vertices, indices);
+    load(vertices, indices);
+}
 
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
+void Mesh::draw() {
+    if (!geometry.isValid()) return;
 
-    vao.unbind();
+    // the vertex array is shared by all meshes of the format, GLState skips rebinding it
+    GeometryArena::bind(geometry.format);
+    glDrawElementsBaseVertex(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, (void*)(geometry.firstIndex * sizeof(unsigned int)), geometry.baseVertex);
 }
 
-void Mesh::load(const std::vector<VertexPCNT>& vertices, const std::vector<unsigned int>& indices) {
-    numIndices = indices.size();
-    vbo.load(Buffer::Type::ARRAY_BUFFER, vertices);
-    ebo.load(Buffer::Type::INDEX_BUFFER, indices);
+void Mesh::drawInstanced(Buffer& instances, size_t first, GLsizei count) {
+    if (!geometry.isValid()) return;
+
+    // OpenGL 4.1 has no base instance, so the attributes are pointed at the first instance of every draw
+    GeometryArena::bindInstances(geometry.format, instances, first);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, (void*)(geometry.firstIndex * sizeof(unsigned int)), count, geometry.baseVertex);
+}
 
-    vao.bind();
-    vbo.bind(Buffer::Type::ARRAY_BUFFER);
-    ebo.bind(Buffer::Type::INDEX_BUFFER);
+void Mesh::draw(const View& view) {
+    if (meshlets.empty()) {
+        draw();
+        return;
+    }
 
-    size_t stride = sizeof(VertexPCNT);
+    cull(view);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexPCNT, position));
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexPCNT, texCoord));
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexPCNT, normal));
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexPCNT, tangent));
+    if (drawCounts.empty()) {
+        return;
+    }
 
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-    glEnableVertexAttribArray(3);
+    drawBaseVertices.assign(drawCounts.size(), geometry.baseVertex);
 
-    vao.unbind();
+    GeometryArena::bind(geometry.format);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(), drawCounts.size(), drawBaseVertices.data());
 }
 
-void Mesh::load(const std::vector<VertexPCNTB>& vertices, const std::vector<unsigned int>& indices) {
-    numIndices = indices.size();
-    vbo.load(Buffer::Type::ARRAY_BUFFER, vertices);
-    ebo.load(Buffer::Type::INDEX_BUFFER, indices);
+void Mesh::appendCommands(GLuint baseInstance, GLuint instanceCount, std::vector<GeometryArena::DrawCommand>& commands) const {
+    if (!geometry.isValid()) return;
 
-    vao.bind();
-    vbo.bind(Buffer::Type::ARRAY_BUFFER);
-    ebo.bind(Buffer::Type::INDEX_BUFFER);
+    commands.push_back({ static_cast<GLuint>(numIndices), instanceCount, geometry.firstIndex, geometry.baseVertex, baseInstance });
+}
 
-    size_t stride = sizeof(VertexPCNTB);
+void Mesh::appendCommands(const View& view, GLuint baseInstance, std::vector<GeometryArena::DrawCommand>& commands) {
+    if (meshlets.empty()) {
+        appendCommands(baseInstance, 1, commands);
+        return;
+    }
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexPCNTB, position));
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexPCNTB, texCoord));
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexPCNTB, normal));
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexPCNTB, tangent));
-    glVertexAttribIPointer(4, 4, GL_INT, stride, (void*)offsetof(VertexPCNTB, boneIDs)); // better not forget the "I" when using integers
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexPCNTB, weights));
+    cull(view);
 
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-    glEnableVertexAttribArray(3);
-    glEnableVertexAttribArray(4);
-    glEnableVertexAttribArray(5);
-    
-    vao.unbind();
+    for (size_t i = 0; i < drawCounts.size(); i++) {
+        GLuint firstIndex = static_cast<GLuint>(reinterpret_cast<uintptr_t>(drawOffsets[i]) / sizeof(unsigned int));
+        commands.push_back({ static_cast<GLuint>(drawCounts[i]), 1, firstIndex, geometry.baseVertex, baseInstance });
+    }
 }
 
-void Mesh::load(const std::string& filepath) {
-    std::vector<VertexPCNT> vertices;
-    std::vector<uint32_t> indices;
-    ObjParser::parse(filepath, vertices, indices);
-    load(vertices, indices);
+void Mesh::cull(const View& view) {
+    Frustum frustum(view.toClip);
+
+    drawCounts.clear();
+    drawOffsets.clear();
+
+    for (const Meshlet& meshlet : meshlets) {
+        if (!isVisible(meshlet, frustum, view)) {
+            continue;
+        }
+
+        // meshlets are stored in index order, so neighboring survivors merge into one range
+        uintptr_t offset = (geometry.firstIndex + meshlet.indexOffset) * sizeof(unsigned int);
+        if (!drawCounts.empty() && reinterpret_cast<uintptr_t>(drawOffsets.back()) + drawCounts.back() * sizeof(unsigned int) == offset) {
+            drawCounts.back() += meshlet.indexCount;
+        } else {
+            drawCounts.push_back(meshlet.indexCount);
+            drawOffsets.push_back(reinterpret_cast<const void*>(offset));
+        }
+    }
 }
 
-void Mesh::draw() {
-    vao.bind();
-    glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, 0);
-    vao.unbind();
+void Mesh::buildMeshlets(const std::vector<vec3>& positions, const std::vector<unsigned int>& indices) {
+    meshlets.clear();
+
+    // greedily grow clusters along the index buffer, so every meshlet stays a contiguous index range
+    std::vector<unsigned int> meshletVertices;
+    meshletVertices.reserve(MAX_MESHLET_VERTICES);
+
+    size_t start = 0;
+    size_t end = 0;
+
+    auto finish = [&]() {
+        if (end == start) {
+            return;
+        }
+
+        Meshlet meshlet;
+        meshlet.indexOffset = start;
+        meshlet.indexCount = end - start;
+
+        // bounding sphere around the center of the bounding box
+        vec3 min(std::numeric_limits<float>::max());
+        vec3 max(std::numeric_limits<float>::lowest());
+        for (unsigned int v : meshletVertices) {
+            min = glm::min(min, positions[v]);
+            max = glm::max(max, positions[v]);
+        }
+
+        meshlet.center = 0.5f * (min + max);
+        meshlet.radius = 0.0f;
+        for (unsigned int v : meshletVertices) {
+            meshlet.radius = std::max(meshlet.radius, length(positions[v] - meshlet.center));
+        }
+
+        // normal cone around the average face normal
+        std::vector<vec3> normals;
+        vec3 axis(0.0f);
+        for (size_t i = start; i < end; i += 3) {
+            vec3 normal = cross(positions[indices[i + 1]] - positions[indices[i]], positions[indices[i + 2]] - positions[indices[i]]);
+            float area = length(normal);
+
+            if (area > 0.0f) {
+                normals.push_back(normal / area);
+                axis += normal / area;
+            }
+        }
+
+        meshlet.coneAxis = vec3(0.0f, 0.0f, 1.0f);
+        meshlet.coneCutoff = 1.0f;
+
+        if (length(axis) > 0.0f) {
+            axis = normalize(axis);
+
+            float minDot = 1.0f;
+            for (const vec3& normal : normals) {
+                minDot = std::min(minDot, dot(normal, axis));
+            }
+
+            // normals spread over more than a hemisphere can't be rejected as a whole
+            if (minDot > 0.0f) {
+                meshlet.coneAxis = axis;
+                meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+            }
+        }
+
+        meshlets.push_back(meshlet);
+
+        meshletVertices.clear();
+        start = end;
+    };
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        size_t newVertices = 0;
+        for (size_t j = 0; j < 3; j++) {
+            if (std::find(meshletVertices.begin(), meshletVertices.end(), indices[i + j]) == meshletVertices.end()) {
+                newVertices++;
+            }
+        }
+
+        if (meshletVertices.size() + newVertices > MAX_MESHLET_VERTICES || (end - start) / 3 + 1 > MAX_MESHLET_TRIANGLES) {
+            finish();
+        }
+
+        for (size_t j = 0; j < 3; j++) {
+            if (std::find(meshletVertices.begin(), meshletVertices.end(), indices[i + j]) == meshletVertices.end()) {
+                meshletVertices.push_back(indices[i + j]);
+            }
+        }
+
+        end = i + 3;
+    }
+
+    finish();
+}
+
+bool Mesh::isVisible(const Meshlet& meshlet, const Frustum& frustum, const View& view) const {
+    if (!frustum.intersectsSphere(meshlet.center, meshlet.radius)) {
+        return false;
+    }
+
+    vec3 axis = view.cullFrontFaces ? -meshlet.coneAxis : meshlet.coneAxis;
+
+    // reject clusters whose triangles all face away from the viewer
+    if (view.eye.w == 0.0f) {
+        return dot(normalize(vec3(view.eye)), axis) < meshlet.coneCutoff;
+    }
+
+    vec3 toCenter = meshlet.center - vec3(view.eye);
+    return dot(toCenter, axis) < meshlet.coneCutoff * length(toCenter) + meshlet.radius;
 }
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "bounds.hpp"
+#include "geometryarena.hpp"
 #include "gl/buffer.hpp"
-#include "gl/vertexarray.hpp"
+#include "frustum.hpp"
 
 #include <glm/glm.hpp>
 #include <assimp/scene.h>
@@ -35,16 +37,72 @@ public:
         float weights[4];
     };
 
+    /* Cluster of at most MAX_MESHLET_VERTICES vertices / MAX_MESHLET_TRIANGLES triangles, stored as a contiguous index range */
+    struct Meshlet {
+        glm::vec3 center;
+        float radius;
+        glm::vec3 coneAxis;
+        float coneCutoff; // sine of the cone half angle, 1 if the cone can't reject anything
+        unsigned int indexOffset;
+        unsigned int indexCount;
+    };
+
+    /* Viewer the meshlets are culled against, in the local space of the mesh */
+    struct View {
+        glm::mat4 toClip;
+        glm::vec4 eye; // camera position (w = 1) or view direction of an orthographic projection (w = 0)
+        bool cullFrontFaces; // shadow passes render back faces only
+    };
+
+    using Instance = GeometryArena::Instance;
+
+    static const unsigned int MAX_MESHLET_VERTICES = 64;
+    static const unsigned int MAX_MESHLET_TRIANGLES = 124;
+
+    Mesh() = default;
+    // Disable copying
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    // Implement moving, the arena range moves with the mesh
+    Mesh(Mesh&& other);
+    Mesh& operator=(Mesh&& other);
+    ~Mesh();
+
     void load(const std::vector<float>& vertices, const std::vector<unsigned int>& indices);
     void load(const std::vector<VertexPCN>& vertices, const std::vector<unsigned int>& indices);
     void load(const std::vector<VertexPCNT>& vertices, const std::vector<unsigned int>& indices);
     void load(const std::vector<VertexPCNTB>& vertices, const std::vector<unsigned int>& indices);
     void load(const std::string& filepath);
+    // name the geometry is listed under in GpuMemory, call after load
+    void label(const std::string& name);
     void draw();
+    void draw(const View& view);
+    // draws count instances starting at instance first of the buffer
+    void drawInstanced(Buffer& instances, size_t first, GLsizei count);
+    // commands for glMultiDrawElementsIndirect, the culled variant emits one command per visible meshlet range
+    void appendCommands(GLuint baseInstance, GLuint instanceCount, std::vector<GeometryArena::DrawCommand>& commands) const;
+    void appendCommands(const View& view, GLuint baseInstance, std::vector<GeometryArena::DrawCommand>& commands);
+
+    const std::vector<Meshlet>& getMeshlets() const { return meshlets; }
+    // object space box around all vertices
+    const Bounds& getBounds() const { return bounds; }
+    GeometryArena::Format getFormat() const { return geometry.format; }
+
+private:
+    // every vertex format starts with the position, stride is the size of one vertex
+    void load(GeometryArena::Format format, const void* vertices, size_t vertexCount, size_t stride, const std::vector<unsigned int>& indices);
+    // fills drawCounts and drawOffsets with the visible index ranges
+    void cull(const View& view);
+    void buildMeshlets(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices);
+    bool isVisible(const Meshlet& meshlet, const Frustum& frustum, const View& view) const;
 
 private:
     unsigned int numIndices = 0;
-    VertexArray vao;
-    Buffer vbo;
-    Buffer ebo;
+    Bounds bounds;
+    std::vector<Meshlet> meshlets;
+    // reused by draw(view) to avoid allocations every frame
+    std::vector<GLsizei> drawCounts;
+    std::vector<const void*> drawOffsets;
+    std::vector<GLint> drawBaseVertices;
+    GeometryArena::Allocation geometry;
 };
@@ -0,0 +1,304 @@
+#include "occlusionbuffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <tuple>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define OCCLUSION_SSE
+#endif
+
+// marks vertices that are not in front of the near plane, their triangles can't be projected
+static constexpr float BEHIND_NEAR = -1.0f;
+
+Occluder Occluder::build(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices) {
+    Occluder occluder;
+
+    // the parser duplicates vertices per face, occluders only need unique positions
+    std::map<std::tuple<float, float, float>, unsigned int> welded;
+    std::vector<unsigned int> remap(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const glm::vec3& position = vertices[i];
+        auto [it, inserted] = welded.emplace(std::make_tuple(position.x, position.y, position.z), static_cast<unsigned int>(occluder.positions.size()));
+
+        if (inserted) {
+            occluder.positions.push_back(position);
+            occluder.bounds.expand(position);
+        }
+
+        remap[i] = it->second;
+    }
+
+    struct Triangle {
+        unsigned int first;
+        float area;
+    };
+
+    std::vector<Triangle> triangles;
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        unsigned int a = remap[indices[i + 0]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+
+        if (a == b || b == c || c == a) {
+            continue;
+        }
+
+        const glm::vec3& p0 = occluder.positions[a];
+        float area = glm::length(glm::cross(occluder.positions[b] - p0, occluder.positions[c] - p0));
+
+        if (area > 0.0f) {
+            triangles.push_back({ static_cast<unsigned int>(i), area });
+        }
+    }
+
+    if (triangles.size() > MAX_TRIANGLES) {
+        std::nth_element(triangles.begin(), triangles.begin() + MAX_TRIANGLES, triangles.end(), [](const Triangle& a, const Triangle& b) {
+            return a.area > b.area;
+        });
+        triangles.resize(MAX_TRIANGLES);
+
+        // back into mesh order, neighbouring triangles share cached projected vertices
+        std::sort(triangles.begin(), triangles.end(), [](const Triangle& a, const Triangle& b) {
+            return a.first < b.first;
+        });
+    }
+
+    for (const Triangle& triangle : triangles) {
+        for (unsigned int corner = 0; corner < 3; corner++) {
+            occluder.indices.push_back(remap[indices[triangle.first + corner]]);
+        }
+    }
+
+    return occluder;
+}
+
+OcclusionBuffer::OcclusionBuffer()
+    : worldToClip(1.0f), depth(WIDTH * HEIGHT, 1.0f), tileMax(TILES_X * TILES_Y, 1.0f), triangles(0) {
+}
+
+void OcclusionBuffer::clear(const glm::mat4& worldToClip) {
+    this->worldToClip = worldToClip;
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    std::fill(tileMax.begin(), tileMax.end(), 1.0f);
+    triangles = 0;
+}
+
+void OcclusionBuffer::rasterize(const Occluder& occluder, const glm::mat4& localToWorld) {
+    glm::mat4 toClip = worldToClip * localToWorld;
+    projected.resize(occluder.positions.size());
+
+    for (size_t i = 0; i < occluder.positions.size(); i++) {
+        glm::vec4 clip = toClip * glm::vec4(occluder.positions[i], 1.0f);
+
+        if (clip.w <= 0.0f || clip.z < -clip.w) {
+            projected[i] = glm::vec3(0.0f, 0.0f, BEHIND_NEAR);
+            continue;
+        }
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        projected[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT, ndc.z * 0.5f + 0.5f);
+    }
+
+    for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3) {
+        const glm::vec3& v0 = projected[occluder.indices[i + 0]];
+        const glm::vec3& v1 = projected[occluder.indices[i + 1]];
+        const glm::vec3& v2 = projected[occluder.indices[i + 2]];
+
+        // clipping would only add occlusion right in front of the camera, skipping is conservative
+        if (v0.z == BEHIND_NEAR || v1.z == BEHIND_NEAR || v2.z == BEHIND_NEAR) {
+            continue;
+        }
+
+        rasterizeTriangle(v0, v1, v2);
+    }
+}
+
+void OcclusionBuffer::rasterizeTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) {
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+
+    if (std::abs(area) < 1e-6f) {
+        return;
+    }
+
+    // counter clockwise order, so all edge functions are positive inside
+    const glm::vec3& a = v0;
+    const glm::vec3& b = area > 0.0f ? v1 : v2;
+    const glm::vec3& c = area > 0.0f ? v2 : v1;
+    area = std::abs(area);
+
+    // blocks of four pixels start at a multiple of four, so they never cross the end of a row
+    int minX = std::max(0, static_cast<int>(std::floor(std::min({ a.x, b.x, c.x })))) & ~3;
+    int maxX = std::min(WIDTH - 1, static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))));
+    int minY = std::max(0, static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))));
+    int maxY = std::min(HEIGHT - 1, static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))));
+
+    if (minX > maxX || minY > maxY) {
+        return;
+    }
+
+    triangles++;
+
+    // edge functions e(x, y) = x * dx + y * dy + offset for the edges ab, bc and ca
+    const glm::vec3 edgeDx(a.y - b.y, b.y - c.y, c.y - a.y);
+    const glm::vec3 edgeDy(b.x - a.x, c.x - b.x, a.x - c.x);
+    glm::vec3 edgeOffset(
+        (b.y - a.y) * a.x - (b.x - a.x) * a.y,
+        (c.y - b.y) * b.x - (c.x - b.x) * b.y,
+        (a.y - c.y) * c.x - (a.x - c.x) * c.y);
+
+    // depth is affine in screen space after the perspective divide
+    const float depthDx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+    const float depthDy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+    float depthOffset = a.z - depthDx * a.x - depthDy * a.y;
+
+    // Pixels are evaluated at their lower left corner. Shifting the edges to the corner that lies the most outside
+    // only keeps pixels the triangle covers completely, and shifting the depth to the farthest corner stores the
+    // farthest depth within the pixel. Both can only lose occlusion, a partly covered pixel never hides anything.
+    edgeOffset += glm::min(edgeDx, 0.0f) + glm::min(edgeDy, 0.0f);
+    depthOffset += std::max(depthDx, 0.0f) + std::max(depthDy, 0.0f);
+
+#ifdef OCCLUSION_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 pixelOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 dx0 = _mm_set1_ps(edgeDx.x), dx1 = _mm_set1_ps(edgeDx.y), dx2 = _mm_set1_ps(edgeDx.z);
+    const __m128 dz = _mm_set1_ps(depthDx);
+#endif
+
+    for (int y = minY; y <= maxY; y++) {
+        const float py = static_cast<float>(y);
+        const glm::vec3 rowEdge = edgeDy * py + edgeOffset;
+        const float rowDepth = depthDy * py + depthOffset;
+        float* row = depth.data() + y * WIDTH;
+
+        int x = minX;
+
+#ifdef OCCLUSION_SSE
+        const __m128 row0 = _mm_set1_ps(rowEdge.x), row1 = _mm_set1_ps(rowEdge.y), row2 = _mm_set1_ps(rowEdge.z);
+        const __m128 rowZ = _mm_set1_ps(rowDepth);
+
+        for (; x <= maxX; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), pixelOffsets);
+
+            __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(dx0, px), row0), zero);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(dx1, px), row1), zero));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(dx2, px), row2), zero));
+
+            if (_mm_movemask_ps(inside) == 0) {
+                continue;
+            }
+
+            __m128 current = _mm_loadu_ps(row + x);
+            __m128 closest = _mm_min_ps(current, _mm_add_ps(_mm_mul_ps(dz, px), rowZ));
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closest), _mm_andnot_ps(inside, current)));
+        }
+#endif
+
+        for (; x <= maxX; x++) {
+            const float px = static_cast<float>(x);
+            const glm::vec3 edge = edgeDx * px + rowEdge;
+
+            if (edge.x < 0.0f || edge.y < 0.0f || edge.z < 0.0f) {
+                continue;
+            }
+
+            row[x] = std::min(row[x], depthDx * px + rowDepth);
+        }
+    }
+}
+
+void OcclusionBuffer::finish() {
+    for (int ty = 0; ty < TILES_Y; ty++) {
+        for (int tx = 0; tx < TILES_X; tx++) {
+            const float* tile = depth.data() + ty * TILE_SIZE * WIDTH + tx * TILE_SIZE;
+            float farthest = 0.0f;
+
+#ifdef OCCLUSION_SSE
+            __m128 farthest4 = _mm_setzero_ps();
+            for (int y = 0; y < TILE_SIZE; y++) {
+                for (int x = 0; x < TILE_SIZE; x += 4) {
+                    farthest4 = _mm_max_ps(farthest4, _mm_loadu_ps(tile + y * WIDTH + x));
+                }
+            }
+
+            farthest4 = _mm_max_ps(farthest4, _mm_shuffle_ps(farthest4, farthest4, _MM_SHUFFLE(1, 0, 3, 2)));
+            farthest4 = _mm_max_ps(farthest4, _mm_shuffle_ps(farthest4, farthest4, _MM_SHUFFLE(2, 3, 0, 1)));
+            farthest = _mm_cvtss_f32(farthest4);
+#else
+            for (int y = 0; y < TILE_SIZE; y++) {
+                for (int x = 0; x < TILE_SIZE; x++) {
+                    farthest = std::max(farthest, tile[y * WIDTH + x]);
+                }
+            }
+#endif
+
+            tileMax[ty * TILES_X + tx] = farthest;
+        }
+    }
+}
+
+bool OcclusionBuffer::isVisible(const Bounds& bounds) const {
+    if (triangles == 0 || !bounds.isValid()) {
+        return true;
+    }
+
+    glm::vec2 screenMin(std::numeric_limits<float>::max());
+    glm::vec2 screenMax(std::numeric_limits<float>::lowest());
+    float nearest = std::numeric_limits<float>::max();
+
+    // depth only grows with the view distance, so the nearest point of the box is one of its corners
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner(i & 1 ? bounds.max.x : bounds.min.x, i & 2 ? bounds.max.y : bounds.min.y, i & 4 ? bounds.max.z : bounds.min.z);
+        glm::vec4 clip = worldToClip * glm::vec4(corner, 1.0f);
+
+        // the box reaches through the near plane, it can cover the whole screen
+        if (clip.w <= 0.0f || clip.z < -clip.w) {
+            return true;
+        }
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 screen((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT);
+
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+    }
+
+    // every pixel the box touches, even partly
+    int minX = std::max(0, static_cast<int>(std::floor(screenMin.x)));
+    int maxX = std::min(WIDTH - 1, static_cast<int>(std::floor(screenMax.x)));
+    int minY = std::max(0, static_cast<int>(std::floor(screenMin.y)));
+    int maxY = std::min(HEIGHT - 1, static_cast<int>(std::floor(screenMax.y)));
+
+    if (minX > maxX || minY > maxY) {
+        return false;
+    }
+
+    // an occluder lying in a face of the box would otherwise hide the box
+    nearest -= 1e-6f;
+
+    for (int ty = minY / TILE_SIZE; ty <= maxY / TILE_SIZE; ty++) {
+        for (int tx = minX / TILE_SIZE; tx <= maxX / TILE_SIZE; tx++) {
+            if (tileMax[ty * TILES_X + tx] <= nearest) {
+                continue;
+            }
+
+            // the tile is partly behind the box, only the pixels inside the box's rectangle decide
+            int x0 = std::max(minX, tx * TILE_SIZE), x1 = std::min(maxX, tx * TILE_SIZE + TILE_SIZE - 1);
+            int y0 = std::max(minY, ty * TILE_SIZE), y1 = std::min(maxY, ty * TILE_SIZE + TILE_SIZE - 1);
+
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) {
+                    if (depth[y * WIDTH + x] > nearest) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
\ No newline at end of file
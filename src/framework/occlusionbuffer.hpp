@@ -0,0 +1,65 @@
+#pragma once
+
+#include "bounds.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Simplified triangle soup of a large object that hides what is behind it, only used by the OcclusionBuffer.
+ * It may cover less than the rendered mesh but never more, otherwise visible objects would be culled.
+ */
+struct Occluder {
+    static constexpr size_t MAX_TRIANGLES = 256;
+
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    Bounds bounds;
+
+    // Welds the vertices and keeps the MAX_TRIANGLES largest triangles, dropping triangles only loses occlusion.
+    static Occluder build(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices);
+};
+
+/**
+ * Low resolution software depth buffer for occlusion culling on the CPU.
+ * Occluders are rasterized four pixels at a time where SSE is available, then the maximum depth of every
+ * tile is kept as a coarse level. isVisible() rejects a box if the tiles it covers are all in front of its
+ * nearest point and only falls back to single pixels for tiles that are partly behind it.
+ * Depth is the normalized device z mapped to [0, 1]. Occluders are rasterized inner-conservatively: a pixel only
+ * takes the farthest depth of a triangle within it, and only if the triangle covers all of it.
+ */
+class OcclusionBuffer {
+   public:
+    static constexpr int WIDTH = 256;
+    static constexpr int HEIGHT = 128;
+    static constexpr int TILE_SIZE = 8;
+    static constexpr int TILES_X = WIDTH / TILE_SIZE;
+    static constexpr int TILES_Y = HEIGHT / TILE_SIZE;
+
+   public:
+    OcclusionBuffer();
+
+    // resets the depth to the far plane, worldToClip is used by the following calls
+    void clear(const glm::mat4& worldToClip);
+    // triangles crossing the near plane are skipped, both windings are drawn
+    void rasterize(const Occluder& occluder, const glm::mat4& localToWorld);
+    // builds the tile level, call after the last occluder
+    void finish();
+
+    // false if every pixel the world space box covers is hidden behind occluders
+    bool isVisible(const Bounds& bounds) const;
+
+    size_t getTriangles() const { return triangles; }
+
+   private:
+    void rasterizeTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2);
+
+   private:
+    glm::mat4 worldToClip;
+    std::vector<float> depth;
+    std::vector<float> tileMax;
+    std::vector<glm::vec3> projected; // screen space positions of the current occluder
+    size_t triangles;                 // rasterized since the last clear
+};
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "rangeallocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// index of the lowest set bit, value must not be 0
+static uint32_t lowestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+// index of the highest set bit, value must not be 0
+static uint32_t highestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+RangeAllocator::RangeAllocator(size_t capacity) {
+    for (auto& bin : bins) bin.fill(NONE);
+    grow(capacity);
+}
+
+void RangeAllocator::mapping(size_t size, uint32_t& fl, uint32_t& sl) {
+    // small sizes share the first level and are binned linearly
+    if (size < SL_COUNT) {
+        fl = 0;
+        sl = static_cast<uint32_t>(size);
+        return;
+    }
+
+    uint32_t msb = highestBit(size);
+    fl = msb - SL_BITS + 1;
+    sl = static_cast<uint32_t>(size >> (msb - SL_BITS)) ^ SL_COUNT;
+}
+
+uint32_t RangeAllocator::createNode(size_t offset, size_t size) {
+    uint32_t index;
+    if (!unusedNodes.empty()) {
+        index = unusedNodes.back();
+        unusedNodes.pop_back();
+        nodes[index] = Node();
+    } else {
+        index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+
+    nodes[index].offset = offset;
+    nodes[index].size = size;
+    return index;
+}
+
+void RangeAllocator::destroyNode(uint32_t node) {
+    // a free range is never empty, so size 0 marks the node as unused
+    nodes[node].size = 0;
+    unusedNodes.push_back(node);
+}
+
+void RangeAllocator::insertFree(uint32_t node) {
+    uint32_t fl, sl;
+    mapping(nodes[node].size, fl, sl);
+
+    uint32_t& head = bins[fl][sl];
+    nodes[node].used = false;
+    nodes[node].binPrev = NONE;
+    nodes[node].binNext = head;
+    if (head != NONE) nodes[head].binPrev = node;
+    head = node;
+
+    flBitmap |= 1ull << fl;
+    slBitmaps[fl] |= 1u << sl;
+}
+
+void RangeAllocator::removeFree(uint32_t node) {
+    Node& n = nodes[node];
+
+    if (n.binPrev != NONE) {
+        nodes[n.binPrev].binNext = n.binNext;
+    } else {
+        uint32_t fl, sl;
+        mapping(n.size, fl, sl);
+
+        bins[fl][sl] = n.binNext;
+        if (n.binNext == NONE) {
+            slBitmaps[fl] &= ~(1u << sl);
+            if (slBitmaps[fl] == 0) flBitmap &= ~(1ull << fl);
+        }
+    }
+
+    if (n.binNext != NONE) nodes[n.binNext].binPrev = n.binPrev;
+
+    n.binPrev = n.binNext = NONE;
+}
+
+RangeAllocator::Range RangeAllocator::allocate(size_t size) {
+    Range range;
+    if (size == 0) {
+        range.offset = 0;
+        range.node = NONE;
+        return range;
+    }
+
+    // round up to the next size class, so every range of the bin found below is large enough
+    size_t rounded = size;
+    if (size >= SL_COUNT) {
+        rounded += (size_t(1) << (highestBit(size) - SL_BITS)) - 1;
+    }
+
+    uint32_t fl, sl;
+    mapping(rounded, fl, sl);
+    if (fl >= FL_COUNT) return range;
+
+    uint32_t slMap = slBitmaps[fl] & (~0u << sl);
+    if (slMap == 0) {
+        uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ull << (fl + 1)) : 0;
+        if (flMap == 0) return range;
+
+        fl = lowestBit(flMap);
+        slMap = slBitmaps[fl];
+    }
+    sl = lowestBit(slMap);
+
+    uint32_t node = bins[fl][sl];
+    removeFree(node);
+    nodes[node].used = true;
+
+    // return the tail to the free bins
+    size_t remaining = nodes[node].size - size;
+    if (remaining > 0) {
+        uint32_t tail = createNode(nodes[node].offset + size, remaining);
+        nodes[node].size = size;
+
+        nodes[tail].prev = node;
+        nodes[tail].next = nodes[node].next;
+        if (nodes[node].next != NONE) nodes[nodes[node].next].prev = tail;
+        nodes[node].next = tail;
+        if (last == node) last = tail;
+
+        insertFree(tail);
+    }
+
+    used += size;
+    allocations++;
+
+    range.offset = nodes[node].offset;
+    range.node = node;
+    return range;
+}
+
+void RangeAllocator::free(Range& range) {
+    if (!range.isValid()) return;
+
+    if (range.node == NONE) {
+        range = Range();
+        return;
+    }
+
+    uint32_t node = range.node;
+    assert(nodes[node].used);
+
+    used -= nodes[node].size;
+    allocations--;
+
+    // merge with the following range
+    uint32_t next = nodes[node].next;
+    if (next != NONE && !nodes[next].used) {
+        removeFree(next);
+        nodes[node].size += nodes[next].size;
+        nodes[node].next = nodes[next].next;
+        if (nodes[next].next != NONE) nodes[nodes[next].next].prev = node;
+        if (last == next) last = node;
+        destroyNode(next);
+    }
+
+    // merge with the preceding range
+    uint32_t prev = nodes[node].prev;
+    if (prev != NONE && !nodes[prev].used) {
+        removeFree(prev);
+        nodes[prev].size += nodes[node].size;
+        nodes[prev].next = nodes[node].next;
+        if (nodes[node].next != NONE) nodes[nodes[node].next].prev = prev;
+        if (last == node) last = prev;
+        destroyNode(node);
+        node = prev;
+    }
+
+    insertFree(node);
+    range = Range();
+}
+
+void RangeAllocator::grow(size_t newCapacity) {
+    if (newCapacity <= capacity) return;
+
+    size_t added = newCapacity - capacity;
+
+    // extend a free range at the old end instead of adding a neighbor
+    if (last != NONE && !nodes[last].used) {
+        removeFree(last);
+        nodes[last].size += added;
+        insertFree(last);
+    } else {
+        uint32_t node = createNode(capacity, added);
+        nodes[node].prev = last;
+        if (last != NONE) nodes[last].next = node;
+        last = node;
+        insertFree(node);
+    }
+
+    capacity = newCapacity;
+}
+
+size_t RangeAllocator::getMaxAllocation() const {
+    if (flBitmap == 0) return 0;
+
+    uint32_t fl = highestBit(flBitmap);
+    uint32_t sl = highestBit(slBitmaps[fl]);
+
+    // inverse of mapping()
+    return fl == 0 ? sl : static_cast<size_t>(SL_COUNT | sl) << (fl - 1);
+}
+
+void RangeAllocator::shrink(size_t newCapacity) {
+    newCapacity = std::max(newCapacity, getEnd());
+    if (newCapacity >= capacity) return;
+
+    // the free range at the end is cut, or removed if nothing of it is left
+    removeFree(last);
+    if (newCapacity > nodes[last].offset) {
+        nodes[last].size = newCapacity - nodes[last].offset;
+        insertFree(last);
+    } else {
+        uint32_t prev = nodes[last].prev;
+        if (prev != NONE) nodes[prev].next = NONE;
+        destroyNode(last);
+        last = prev;
+    }
+
+    capacity = newCapacity;
+}
+
+RangeAllocator::Stats RangeAllocator::getStats() const {
+    Stats stats;
+    stats.capacity = capacity;
+    stats.used = used;
+    stats.allocations = allocations;
+
+    for (const Node& node : nodes) {
+        if (node.used || node.size == 0) continue;
+
+        stats.freeRanges++;
+        stats.largestFree = std::max(stats.largestFree, node.size);
+    }
+
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Hands out ranges of a linear resource, e.g. the elements of a buffer
+ * Two-level segregated fit (TLSF): free ranges are kept in bins by size class, the first level is the power of two,
+ * the second level splits it into SL_COUNT linear steps. Bitmaps of non-empty bins make allocate() and free() O(1),
+ * neighboring free ranges are merged on free().
+ */
+class RangeAllocator {
+public:
+    static constexpr size_t INVALID = SIZE_MAX;
+
+    struct Range {
+        size_t offset = INVALID;
+        uint32_t node = 0;
+
+        bool isValid() const { return offset != INVALID; }
+    };
+
+    struct Stats {
+        size_t capacity = 0;
+        size_t used = 0;
+        size_t allocations = 0;
+        size_t freeRanges = 0;
+        size_t largestFree = 0;
+
+        // share of the free space that can't be handed out as one range
+        float fragmentation() const {
+            size_t free = capacity - used;
+            return free > 0 ? 1.0f - static_cast<float>(largestFree) / free : 0.0f;
+        }
+    };
+
+    explicit RangeAllocator(size_t capacity = 0);
+
+    // invalid if no free range is large enough
+    Range allocate(size_t size);
+    void free(Range& range);
+    // appends free space at the end
+    void grow(size_t capacity);
+    // drops free space at the end, the capacity never goes below getEnd()
+    void shrink(size_t capacity);
+
+    size_t getCapacity() const { return capacity; }
+    size_t getUsed() const { return used; }
+    // end of the last used range
+    size_t getEnd() const { return last != NONE && !nodes[last].used ? nodes[last].offset : capacity; }
+    // empty ranges have no node
+    size_t getSize(const Range& range) const { return range.isValid() && range.node != NONE ? nodes[range.node].size : 0; }
+    // largest size allocate() is guaranteed to succeed for, the lower bound of the largest non-empty bin
+    size_t getMaxAllocation() const;
+    Stats getStats() const;
+
+private:
+    static constexpr uint32_t SL_BITS = 5;
+    static constexpr uint32_t SL_COUNT = 1 << SL_BITS;
+    static constexpr uint32_t FL_COUNT = 64 - SL_BITS + 1;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node {
+        size_t offset = 0;
+        size_t size = 0;
+        uint32_t binPrev = NONE; // free list of the bin
+        uint32_t binNext = NONE;
+        uint32_t prev = NONE;    // physical neighbors
+        uint32_t next = NONE;
+        bool used = false;
+    };
+
+    static void mapping(size_t size, uint32_t& fl, uint32_t& sl);
+
+    uint32_t createNode(size_t offset, size_t size);
+    void destroyNode(uint32_t node);
+    void insertFree(uint32_t node);
+    void removeFree(uint32_t node);
+
+private:
+    std::vector<Node> nodes;
+    std::vector<uint32_t> unusedNodes;
+
+    uint64_t flBitmap = 0;
+    std::array<uint32_t, FL_COUNT> slBitmaps = {};
+    std::array<std::array<uint32_t, SL_COUNT>, FL_COUNT> bins;
+
+    uint32_t last = NONE; // node at the end of the resource
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t allocations = 0;
+};
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+
+/**
+ * Function local instance that is never destroyed.
+ * GL wrappers in static storage, e.g. the ones held by the resource registries, free their handles during
+ * static destruction. Everything they report to on the way (state cache, memory tracking, suballocators)
+ * has to outlive them, whatever order the translation units are torn down in.
+ */
+template <typename T>
+T& leakedSingleton() {
+    static T* instance = new T();
+    return *instance;
+}
\ No newline at end of file
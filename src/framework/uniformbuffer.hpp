@@ -1,7 +1,11 @@
 #pragma once
 
 #include "gl/buffer.hpp"
+#include "gl/streambuffer.hpp"
 
+/**
+ * Uniform block that is streamed, every upload goes to a fresh range and rebinds the block index to it
+ */
 template <typename T>
 class UniformBuffer {
    public:
@@ -9,21 +13,37 @@ class UniformBuffer {
     void upload(const T& uniforms);
     void bind(unsigned int index);
 
-    Buffer buffer;
+    StreamBuffer stream;
+
+   private:
+    static GLint offsetAlignment();
+
+    unsigned int index;
+    GLintptr offset = 0;
 };
 
 template <typename T>
-UniformBuffer<T>::UniformBuffer(unsigned int index, const T& uniforms) : buffer() {
-    buffer.bind(Buffer::Type::UNIFORM_BUFFER, index);
-    buffer.load(Buffer::Type::UNIFORM_BUFFER, uniforms);
+UniformBuffer<T>::UniformBuffer(unsigned int index, const T& uniforms) : stream(), index(index) {
+    upload(uniforms);
+}
+
+template <typename T>
+GLint UniformBuffer<T>::offsetAlignment() {
+    static const GLint alignment = [] {
+        GLint value = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+        return value;
+    }();
+    return alignment;
 }
 
 template <typename T>
 void UniformBuffer<T>::upload(const T& uniforms) {
-    buffer.set(Buffer::Type::UNIFORM_BUFFER, uniforms);
+    offset = stream.write(&uniforms, sizeof(T), offsetAlignment());
+    bind(index);
 }
 
 template <typename T>
 void UniformBuffer<T>::bind(unsigned int index) {
-    buffer.bind(Buffer::Type::UNIFORM_BUFFER, index);
+    stream.getBuffer().bind(Buffer::Type::UNIFORM_BUFFER, index, offset, sizeof(T));
 }
\ No newline at end of file
@@ -2,7 +2,10 @@
 
 #include "framework/imguiutil.hpp"
 #include "framework/common.hpp"
+#include "framework/gl/glstate.hpp"
+#include "framework/gl/gpumemory.hpp"
 #include "renderer/renderobject.hpp"
+#include "config.hpp"
 
 #include <glad/glad.h>
 #include <imgui.h>
@@ -17,6 +20,9 @@ using namespace glm;
 #include <memory>
 #include <typeinfo>
 
+// distance from the camera beyond which houses are drawn as impostors
+const float IMPOSTOR_DISTANCE = 45.0f;
+
 MainApp::MainApp()
         : App(1200, 800),
           cam(std::make_shared<MovingCamera>(glm::vec3(10.0f, 10.0f, 40.0f), glm::vec3(0.0f, 5.0f, 10.0f))),
@@ -28,6 +34,8 @@ MainApp::MainApp()
           soundPlayed(false)
 {
     Common::randomSeed();
+    GpuMemory::setBudget(Config::GPU_MEMORY_BUDGET);
+    ResourceManager::setMemoryBudget({ Config::ASSET_CPU_BUDGET, Config::ASSET_GPU_BUDGET });
 
     App::setTitle("cgintro"); // set title
     App::setVSync(true); // Limit framerate
@@ -42,6 +50,8 @@ MainApp::MainApp()
 
     cam->setResolution(resolution);
 
+    loadShaders();
+
     ResourceManager::loadAnimationModel("rigged_model/happy.dae", "happy_boy");
     ResourceManager::loadAnimation("rigged_model/happy.dae", "happy_boy", "happy_boy_anim");
 
@@ -49,9 +59,11 @@ MainApp::MainApp()
     ResourceManager::loadAnimation("rigged_model/sadly.dae", "sad_boy", "sad_boy_anim");
         //animator.playAnimation(&ResourceManager::getAnimation("happy_boy_anim"));
 
-    loadShaders();
     loadObjects();
     loadTextures();
+    loadImpostors();
+    loadOccluders();
+    initShaders(); // after loading so compilation overlaps with it
 
     initParticleSystem();
 
@@ -80,8 +92,8 @@ MainApp::MainApp()
 }
 
 void MainApp::init() {
-    glDepthFunc(GL_LESS);
-    glEnable(GL_CULL_FACE);
+    GLState::depthFunc(GL_LESS);
+    GLState::enable(GL_CULL_FACE);
 }
 
 void MainApp::resetRenderTimer(float duration) {
@@ -91,6 +103,9 @@ void MainApp::resetRenderTimer(float duration) {
 }
 
 void MainApp::render() {
+    // finish textures that were decoded in the background, evict unused assets
+    ResourceManager::update();
+
     //std::cout << "elapsedTime: " << elapsedTime << std::endl;
 //    if (elapsedTime < 50) {
 //        if (!soundPlayed) {
@@ -159,8 +174,8 @@ void MainApp::render() {
     }
     // update lightning meshes
     if (sceneIdx == 1) {
-        if (elapsedTime - currSceneStart > 0.3f) scene1->getRenderObject(simpleGeomId, lightningObjId).setMesh("lightning1");
-        if (elapsedTime - currSceneStart > 0.6f) scene1->getRenderObject(simpleGeomId, lightningObjId).setMesh("lightning2");
+        if (elapsedTime - currSceneStart > 0.3f) scene1->getRenderObject(simpleGeomId, lightningObjId).setMesh(lightningMeshes[1].getHandle());
+        if (elapsedTime - currSceneStart > 0.6f) scene1->getRenderObject(simpleGeomId, lightningObjId).setMesh(lightningMeshes[2].getHandle());
         if (elapsedTime - currSceneStart > 0.9f)  {
             scene1->removeRenderObject(simpleGeomId, lightningObjId);
             scene1->removePointLight(0);
@@ -177,12 +192,6 @@ void MainApp::render() {
         renderer.updateCamUniforms();
     }
 
-    const auto& transforms = animator.getFinalBoneMatrices();
-
-    for (int i = 0; i < transforms.size(); i++) {
-        animated->set("uFinalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
-    }
-
     renderer.draw();
   
     if (animationRunning) {
@@ -201,6 +210,42 @@ void MainApp::render() {
 }
 
 
+void MainApp::buildImGui() {
+    if (showGpuMemory) ImGui::GpuMemoryWindow();
+
+    if (showRenderStats) {
+        const RenderStats& stats = renderer.getStats();
+
+        ImGui::Begin("Render stats");
+
+        bool occlusionCulling = renderer.getOcclusionCulling();
+        if (ImGui::Checkbox("Occlusion culling", &occlusionCulling)) {
+            renderer.setOcclusionCulling(occlusionCulling);
+        }
+
+        bool occlusionQueries = renderer.getOcclusionQueries();
+        if (ImGui::Checkbox("Occlusion queries", &occlusionQueries)) {
+            renderer.setOcclusionQueries(occlusionQueries);
+        }
+
+        ImGui::Text("Objects drawn / culled / occluded: %zu / %zu / %zu", stats.objects, stats.culled, stats.occluded);
+        ImGui::Text("Occlusion queries / conditional draws: %zu / %zu", stats.queries, stats.conditional);
+        ImGui::Text("Draws: %zu", stats.draws);
+        ImGui::Text("Instanced objects: %zu", stats.instances);
+        ImGui::Text("Program binds: %zu", stats.programBinds);
+        ImGui::Text("Material changes: %zu", stats.materialChanges);
+        ImGui::Text("Texture binds: %zu", stats.textureBinds);
+        ImGui::Text("Mesh changes: %zu", stats.meshChanges);
+
+        ImGui::SeparatorText("GL state (issued / skipped)");
+        for (size_t i = 0; i < static_cast<size_t>(GLState::Category::COUNT); i++) {
+            const GLState::Counter& counter = GLState::getCounters()[i];
+            ImGui::Text("%s: %zu / %zu", GLState::getName(static_cast<GLState::Category>(i)), counter.issued, counter.skipped);
+        }
+        ImGui::End();
+    }
+}
+
 //void MainApp::buildImGui() {
 //    if (ImGui::SphericalSlider("Light direction", lightDir)) {
 //        scene0->getDirLight()->setDirection(lightDir);
@@ -227,6 +272,10 @@ void MainApp::keyCallback(Key key, Action action) {
         cam->move(delta * cameraSpeed * glm::vec3(0.0f, -1.0f, 0.0f));
     } else if (key == Key::F) {
         animationRunning = !animationRunning;
+    } else if (key == Key::M) {
+        showGpuMemory = !showGpuMemory;
+    } else if (key == Key::R) {
+        showRenderStats = !showRenderStats;
     }
 }
 
@@ -246,20 +295,25 @@ void MainApp::resizeCallback(const glm::vec2& resolution) {
 }
 
 void MainApp::loadShaders() {
+    const std::vector<std::string> instanced = { "INSTANCED" };
+
     simpleGeom = std::make_shared<Program>();
     simpleGeom->load("simple_geometry.vert", "simple_geometry.frag");
-    simpleGeomId = renderer.addProgram(simpleGeom);
+    simpleGeomInstanced = std::make_shared<Program>();
+    simpleGeomInstanced->load("simple_geometry.vert", "simple_geometry.frag", instanced);
+    simpleGeomId = renderer.addProgram(simpleGeom, simpleGeomInstanced);
 
     texturedGeomNormals = std::make_shared<Program>();
     texturedGeomNormals->load("textured_geometry_normals.vert", "textured_geometry_normals.frag");
-    texturedGeomNormals->bindTextureUnit("uDiffuseTexture", 0);
-    texturedGeomNormals->bindTextureUnit("uNormalTexture", 1);
-    texturedGeomNormalsId = renderer.addProgram(texturedGeomNormals);
+    texturedGeomNormalsInstanced = std::make_shared<Program>();
+    texturedGeomNormalsInstanced->load("textured_geometry_normals.vert", "textured_geometry_normals.frag", instanced);
+    texturedGeomNormalsId = renderer.addProgram(texturedGeomNormals, texturedGeomNormalsInstanced);
 
     texturedGeom = std::make_shared<Program>();
     texturedGeom->load("textured_geometry.vert", "textured_geometry.frag");
-    texturedGeom->bindTextureUnit("uDiffuseTexture", 0);
-    texturedGeomId = renderer.addProgram(texturedGeom);
+    texturedGeomInstanced = std::make_shared<Program>();
+    texturedGeomInstanced->load("textured_geometry.vert", "textured_geometry.frag", instanced);
+    texturedGeomId = renderer.addProgram(texturedGeom, texturedGeomInstanced);
 
     animated = std::make_shared<Program>();
     animated->load("assimpshader.vert", "assimpshader.frag");
@@ -267,9 +321,27 @@ void MainApp::loadShaders() {
 
     tiledGeom = std::make_shared<Program>();
     tiledGeom->load("tiled_textured_geometry.vert", "tiled_textured_geometry.frag");
-    tiledGeom->bindTextureUnit("uDiffuseTexture", 0);
-    tiledGeom->set("uTileFactor", 40.0f);
-    tiledGeomId = renderer.addProgram(tiledGeom);
+    tiledGeomInstanced = std::make_shared<Program>();
+    tiledGeomInstanced->load("tiled_textured_geometry.vert", "tiled_textured_geometry.frag", instanced);
+    tiledGeomId = renderer.addProgram(tiledGeom, tiledGeomInstanced);
+}
+
+void MainApp::initShaders() {
+    animated->bindTextureUnit("uBonePalette", SkinningPalette::TEXTURE_UNIT);
+
+    for (auto& program : { texturedGeomNormals, texturedGeomNormalsInstanced }) {
+        program->bindTextureUnit("uDiffuseTexture", 0);
+        program->bindTextureUnit("uNormalTexture", 1);
+    }
+
+    for (auto& program : { texturedGeom, texturedGeomInstanced }) {
+        program->bindTextureUnit("uDiffuseTexture", 0);
+    }
+
+    for (auto& program : { tiledGeom, tiledGeomInstanced }) {
+        program->bindTextureUnit("uDiffuseTexture", 0);
+        program->set("uTileFactor", 40.0f);
+    }
 }
 
 void MainApp::loadObjects() {
@@ -284,18 +356,29 @@ void MainApp::loadObjects() {
         auto lightningMeshData = LightningGenerator::genMeshData(glm::vec3(-5.0f, 60.0f, 15.0f), glm::vec3(0.0f, 10.0f, 5.0f), 7, cam->getDirection());
         Mesh lightningMesh;
         lightningMesh.load(lightningMeshData.first, lightningMeshData.second);
-        ResourceManager::addMesh(std::move(lightningMesh), "lightning" + std::to_string(i));
+        lightningMeshes[i] = ResourceManager::acquire(ResourceManager::addMesh(std::move(lightningMesh), "lightning" + std::to_string(i)));
     }
 
 }
 
 void MainApp::loadTextures() {
-    ResourceManager::loadTexture("textures/cottage_diffuse.png", "house_diffuse");
-    ResourceManager::loadTexture("textures/cottage_normal.png", "house_normal");
-    ResourceManager::loadTexture("textures/text.jpg", "ruin_diffuse");
-    ResourceManager::loadTexture("textures/normalmap.jpg", "ruin_normal");
-    ResourceManager::loadTexture("textures/superbible.jpg", "superbible");
-    ResourceManager::loadTexture("textures/grass_tileable.jpg", "grass");
+    ResourceManager::loadTextureAsync("textures/cottage_diffuse.png", "house_diffuse");
+    ResourceManager::loadTextureAsync("textures/cottage_normal.png", "house_normal");
+    ResourceManager::loadTextureAsync("textures/text.jpg", "ruin_diffuse");
+    ResourceManager::loadTextureAsync("textures/normalmap.jpg", "ruin_normal");
+    ResourceManager::loadTextureAsync("textures/superbible.jpg", "superbible");
+    ResourceManager::loadTextureAsync("textures/grass_tileable.jpg", "grass");
+}
+
+void MainApp::loadImpostors() {
+    ResourceManager::loadImpostor("meshes/cottage.obj", "textures/cottage_diffuse.png", "house_impostor");
+    ResourceManager::loadImpostor("meshes/ruined_building.obj", "textures/text.jpg", "ruin_impostor");
+}
+
+void MainApp::loadOccluders() {
+    // houses and ruins hide large parts of the scenes from the camera paths
+    ResourceManager::loadOccluder("meshes/cottage.obj", "house_occluder");
+    ResourceManager::loadOccluder("meshes/ruined_building.obj", "ruin_occluder");
 }
 
 void MainApp::initParticleSystem() {
@@ -516,6 +599,9 @@ void MainApp::createRenderObjects() {
     house0.setMesh("house");
     house0.setDiffuseTexture("house_diffuse");
     house0.setNormalTexture("house_normal");
+    house0.setImpostor("house_impostor", IMPOSTOR_DISTANCE);
+    house0.setOccluder("house_occluder");
+    house0.setOcclusionQuery(true);
     scene0->addRenderObject(std::move(house0), texturedGeomNormalsId);
 
     RenderObject ground0;
@@ -526,6 +612,8 @@ void MainApp::createRenderObjects() {
 
     RenderObject happy0;
     happy0.setAnimationModel("happy_boy");
+    happy0.setOcclusionQuery(true);
+    happy0.setAnimator(&animator);
     happy0.setPosition(glm::vec3(0.0f, 0.0f, 40.0f));
     happy0.setRotation(glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     scene0->addRenderObject(std::move(happy0), animatedId);
@@ -535,6 +623,9 @@ void MainApp::createRenderObjects() {
     house1.setMesh("house");
     house1.setDiffuseTexture("house_diffuse");
     house1.setNormalTexture("house_normal");
+    house1.setImpostor("house_impostor", IMPOSTOR_DISTANCE);
+    house1.setOccluder("house_occluder");
+    house1.setOcclusionQuery(true);
     scene1->addRenderObject(std::move(house1), texturedGeomNormalsId);
 
     RenderObject ground1;
@@ -545,6 +636,8 @@ void MainApp::createRenderObjects() {
 
     RenderObject sad0;
     sad0.setAnimationModel("sad_boy");
+    sad0.setOcclusionQuery(true);
+    sad0.setAnimator(&animator);
     sad0.setPosition(glm::vec3(0.0f, 0.0f, 40.0f));
     sad0.setRotation(glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     scene1->addRenderObject(std::move(sad0), animatedId);
@@ -559,6 +652,9 @@ void MainApp::createRenderObjects() {
     house2.setMesh("house");
     house2.setDiffuseTexture("house_diffuse");
     house2.setNormalTexture("house_normal");
+    house2.setImpostor("house_impostor", IMPOSTOR_DISTANCE);
+    house2.setOccluder("house_occluder");
+    house2.setOcclusionQuery(true);
     scene2->addRenderObject(std::move(house2), texturedGeomNormalsId);
 
     RenderObject ground2;
@@ -569,6 +665,8 @@ void MainApp::createRenderObjects() {
 
     RenderObject sad1;
     sad1.setAnimationModel("sad_boy");
+    sad1.setOcclusionQuery(true);
+    sad1.setAnimator(&animator);
     sad1.setPosition(glm::vec3(0.0f, 0.0f, 40.0f));
     sad1.setRotation(glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     scene2->addRenderObject(std::move(sad1), animatedId);
@@ -578,6 +676,9 @@ void MainApp::createRenderObjects() {
     house4.setMesh("ruin");
     house4.setDiffuseTexture("ruin_diffuse");
     house4.setNormalTexture("ruin_normal");
+    house4.setImpostor("ruin_impostor", IMPOSTOR_DISTANCE);
+    house4.setOccluder("ruin_occluder");
+    house4.setOcclusionQuery(true);
     house4.setRotation(glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     house4.setScale(2.0f);
     scene4->addRenderObject(std::move(house4), texturedGeomNormalsId);
@@ -590,6 +691,8 @@ void MainApp::createRenderObjects() {
 
     RenderObject sad3;
     sad3.setAnimationModel("sad_boy");
+    sad3.setOcclusionQuery(true);
+    sad3.setAnimator(&animator);
     sad3.setPosition(glm::vec3(0.0f, 0.0f, 40.0f));
     sad3.setRotation(glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     scene4->addRenderObject(std::move(sad3), animatedId);
@@ -607,6 +710,9 @@ void MainApp::createRenderObjects() {
     house5.setMesh("ruin");
     house5.setDiffuseTexture("ruin_diffuse");
     house5.setNormalTexture("ruin_normal");
+    house5.setImpostor("ruin_impostor", IMPOSTOR_DISTANCE);
+    house5.setOccluder("ruin_occluder");
+    house5.setOcclusionQuery(true);
     house5.setRotation(glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     house5.setScale(2.0f);
     scene5->addRenderObject(std::move(house5), texturedGeomNormalsId);
@@ -619,6 +725,8 @@ void MainApp::createRenderObjects() {
 
     RenderObject happy5;
     happy5.setAnimationModel("happy_boy");
+    happy5.setOcclusionQuery(true);
+    happy5.setAnimator(&animator);
     happy5.setPosition(glm::vec3(0.0f, 0.0f, 40.0f));
     happy5.setRotation(glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     scene5->addRenderObject(std::move(happy5), animatedId);
@@ -636,6 +744,9 @@ void MainApp::createRenderObjects() {
     house6.setMesh("house");
     house6.setDiffuseTexture("house_diffuse");
     house6.setNormalTexture("house_normal");
+    house6.setImpostor("house_impostor", IMPOSTOR_DISTANCE);
+    house6.setOccluder("house_occluder");
+    house6.setOcclusionQuery(true);
     scene6->addRenderObject(std::move(house6), texturedGeomNormalsId);
 
     RenderObject ground6;
@@ -646,6 +757,8 @@ void MainApp::createRenderObjects() {
 
     RenderObject happy6;
     happy6.setAnimationModel("happy_boy");
+    happy6.setOcclusionQuery(true);
+    happy6.setAnimator(&animator);
     happy6.setPosition(glm::vec3(0.0f, 0.0f, 40.0f));
     happy6.setRotation(glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     scene6->addRenderObject(std::move(happy6), animatedId);
@@ -3,6 +3,7 @@
 #include <glm/glm.hpp>
 
 #include <vector>
+#include <array>
 #include <memory>
 
 #include "lightninggenerator.hpp"
@@ -34,7 +35,7 @@ public:
 
 protected:
     void init() override;
-    //void buildImGui() override;
+    void buildImGui() override;
     void render() override;
     void keyCallback(Key key, Action action) override;
     void scrollCallback(float amount) override;
@@ -43,8 +44,11 @@ protected:
     void resetRenderTimer(float duration);
 
     void loadShaders();
+    void initShaders();
     void loadObjects();
     void loadTextures();
+    void loadImpostors();
+    void loadOccluders();
     void initParticleSystem();
     void createCameraPaths();
     void createMaterials();
@@ -54,6 +58,8 @@ protected:
 private:
     std::shared_ptr<MovingCamera> cam;
     bool showControlPoints = false;
+    bool showGpuMemory = false;
+    bool showRenderStats = false;
 
     Renderer renderer;
     int sceneIdx = -1;
@@ -74,19 +80,20 @@ private:
 
     std::shared_ptr<Texture> tex;
 
-    std::shared_ptr<Program> simpleGeom;
+    // the instanced variants draw objects that share mesh and material at once
+    std::shared_ptr<Program> simpleGeom, simpleGeomInstanced;
     size_t simpleGeomId;
 
-    std::shared_ptr<Program> texturedGeomNormals;
+    std::shared_ptr<Program> texturedGeomNormals, texturedGeomNormalsInstanced;
     size_t texturedGeomNormalsId;
 
-    std::shared_ptr<Program> texturedGeom;
+    std::shared_ptr<Program> texturedGeom, texturedGeomInstanced;
     size_t texturedGeomId;
 
     std::shared_ptr<Program> animated;
     size_t animatedId;
 
-    std::shared_ptr<Program> tiledGeom;
+    std::shared_ptr<Program> tiledGeom, tiledGeomInstanced;
     size_t tiledGeomId;
 
     Animator animator;
@@ -99,4 +106,5 @@ private:
 
     bool animationRunning = false;
     size_t lightningObjId;
+    std::array<MeshRef, 3> lightningMeshes;
 };
@@ -8,11 +8,34 @@
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <utility>
+
+static constexpr UniformName U_TIME("u_Time");
+static constexpr UniformName U_VIEW_PROJ("u_ViewProj");
 
 ParticleSystem::ParticleSystem() {
     shader.load("particleshader.vert", "particleshader.frag");
 }
 
+ParticleSystem::ParticleSystem(ParticleSystem&& other)
+    : particles(std::move(other.particles)), vao(std::move(other.vao)), vbo(std::exchange(other.vbo, BufferHeap::Allocation())), shader(std::move(other.shader)) {
+}
+
+ParticleSystem& ParticleSystem::operator=(ParticleSystem&& other) {
+    if (this != &other) {
+        BufferHeap::free(vbo);
+        particles = std::move(other.particles);
+        vao = std::move(other.vao);
+        vbo = std::exchange(other.vbo, BufferHeap::Allocation());
+        shader = std::move(other.shader);
+    }
+    return *this;
+}
+
+ParticleSystem::~ParticleSystem() {
+    BufferHeap::free(vbo);
+}
+
 float generateLifetime() {
     float lambda = 1.0f / 10.0f; // Adjust the rate parameter for the exponential distribution
     float random = Common::randomFloat();
@@ -43,26 +66,33 @@ void ParticleSystem::init() {
 
     glPointSize(2.5f);
 
+    BufferHeap::free(vbo);
+    vbo = BufferHeap::allocate(sizeof(Particle) * particles.size());
+    BufferHeap::upload(vbo, particles.data(), vbo.size);
+
+    // the particles live somewhere inside a shared page
+    size_t base = vbo.offset;
+
     vao.bind();
-    vbo.load(Buffer::Type::ARRAY_BUFFER, particles);
+    vbo.buffer->bind(Buffer::Type::ARRAY_BUFFER);
 
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, position));
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)(base + offsetof(Particle, position)));
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, velocity));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)(base + offsetof(Particle, velocity)));
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, lifetime));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)(base + offsetof(Particle, lifetime)));
     glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE,  sizeof(Particle), (void*)offsetof(Particle, type));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE,  sizeof(Particle), (void*)(base + offsetof(Particle, type)));
 }
 
 void ParticleSystem::update(float time) {
-    shader.set("u_Time", time);
+    shader.set(U_TIME, time);
 }
 
 void ParticleSystem::render(const glm::mat4& viewProj) {
     shader.bind();
-    shader.set("u_ViewProj", viewProj);
+    shader.set(U_VIEW_PROJ, viewProj);
 
     vao.bind();
     glDrawArrays(GL_POINTS, 0, particles.size());
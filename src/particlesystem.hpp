@@ -1,6 +1,6 @@
 #pragma once
 
-#include "framework/gl/buffer.hpp"
+#include "framework/bufferheap.hpp"
 #include "framework/gl/vertexarray.hpp"
 #include "framework/gl/program.hpp"
 
@@ -11,6 +11,11 @@
 class ParticleSystem {
 public:
     ParticleSystem();
+    ParticleSystem(const ParticleSystem&) = delete;
+    ParticleSystem& operator=(const ParticleSystem&) = delete;
+    ParticleSystem(ParticleSystem&& other);
+    ParticleSystem& operator=(ParticleSystem&& other);
+    ~ParticleSystem();
 
     void init();
     void update(float time);
@@ -28,7 +33,7 @@ private:
     std::vector<Particle> particles;
 
     VertexArray vao;
-    Buffer vbo;
+    BufferHeap::Allocation vbo;
 
     Program shader;
 };
@@ -0,0 +1,509 @@
+#pragma once
+
+#include <array>
+#include <iterator>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Compact reference to an entry of a Registry<T>.
+ * The generation detects handles whose slot has been freed and reused since.
+ */
+template<typename T>
+struct Handle {
+	static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	uint32_t index = INVALID_INDEX;
+	uint32_t generation = 0;
+
+	bool isValid() const { return index != INVALID_INDEX; }
+
+	bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+// memory held by an asset, used for budgeted eviction
+struct AssetSize {
+	size_t cpu = 0;
+	size_t gpu = 0;
+};
+
+enum class AssetState : uint8_t {
+	PENDING, // handle reserved, nothing loaded yet
+	LOADING, // a loader is working on the asset
+	READY,   // asset can be used
+	FAILED,  // loading threw, the slot stays empty
+	EVICTED  // dropped to stay within the memory budget, can be loaded again from its source
+};
+
+/**
+ * Stores resources in slots that are addressed by generational handles.
+ * Lookups by handle are plain array accesses, names are only resolved when authoring scenes.
+ *
+ * Slots live in pages that are never moved or freed, so reading through a handle (get, getState) is lock-free
+ * and may happen on any thread. Everything that changes the registry is serialized by a mutex, so loaders
+ * can reserve and publish assets from worker threads. Replacing or removing an asset that is already READY
+ * must still happen on the render thread, because it may be drawing it at the same time.
+ *
+ * Assets loaded from files remember their source, so loading the same file again returns the existing handle.
+ * AssetRef<T> keeps a reference count per slot, only unreferenced assets with a source are evicted when over
+ * budget, least recently used first. Eviction keeps the name, source and handle, so the asset can be loaded again.
+ */
+template<typename T>
+class Registry {
+public:
+	static constexpr uint32_t PAGE_SIZE = 256;
+	static constexpr uint32_t MAX_PAGES = 256;
+
+public:
+	Registry() : m_Size(0) {
+		for (std::atomic<Page*>& page : m_Pages) {
+			page.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	Registry(const Registry&) = delete;
+	Registry& operator=(const Registry&) = delete;
+
+	~Registry() {
+		for (std::atomic<Page*>& page : m_Pages) {
+			delete page.load(std::memory_order_relaxed);
+		}
+	}
+
+	// returns the existing handle if the name or source is already registered, otherwise a new PENDING slot.
+	// A different source under a registered name rebinds the name, handles to the previous asset stay valid.
+	Handle<T> reserve(const std::string& name, const std::string& source = "") {
+		std::unique_lock<std::shared_mutex> lock(m_Mutex);
+
+		auto it = m_Names.find(name);
+
+		if (it != m_Names.end() && (source.empty() || getSlot(it->second.index).source == source)) {
+			return it->second;
+		}
+
+		if (!source.empty()) {
+			auto sourceIt = m_Sources.find(source);
+
+			// the same file under another name, register the name as an alias
+			if (sourceIt != m_Sources.end()) {
+				m_Names[name] = sourceIt->second;
+				return sourceIt->second;
+			}
+		}
+
+		Handle<T> handle;
+
+		if (!m_FreeSlots.empty()) {
+			handle.index = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+		} else {
+			handle.index = allocateSlot();
+		}
+
+		Slot& slot = getSlot(handle.index);
+		slot.name = name;
+		slot.source = source;
+		slot.refCount.store(0, std::memory_order_relaxed);
+		slot.lastUsed.store(m_Clock.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		slot.state.store(AssetState::PENDING, std::memory_order_release);
+		handle.generation = slot.generation.load(std::memory_order_relaxed);
+
+		m_Names[name] = handle;
+
+		if (!source.empty()) {
+			m_Sources[source] = handle;
+		}
+
+		return handle;
+	}
+
+	// adding under an existing name replaces the resource and keeps its handle, it no longer stands for a file then
+	Handle<T> add(T&& value, const std::string& name) {
+		Handle<T> handle = reserve(name);
+
+		{
+			std::unique_lock<std::shared_mutex> lock(m_Mutex);
+
+			Slot& slot = getSlot(handle.index);
+			m_Sources.erase(slot.source);
+			slot.source.clear();
+		}
+
+		publish(handle, std::move(value));
+
+		return handle;
+	}
+
+	// moves a PENDING or FAILED asset to LOADING, returns false if it is loaded or another loader already claimed it
+	bool beginLoading(Handle<T> handle) {
+		std::unique_lock<std::shared_mutex> lock(m_Mutex);
+
+		if (!isCurrent(handle)) {
+			return false;
+		}
+
+		AssetState state = getSlot(handle.index).state.load(std::memory_order_relaxed);
+
+		if (state != AssetState::PENDING && state != AssetState::FAILED && state != AssetState::EVICTED) {
+			return false;
+		}
+
+		getSlot(handle.index).state.store(AssetState::LOADING, std::memory_order_release);
+
+		return true;
+	}
+
+	void publish(Handle<T> handle, T&& value, const AssetSize& size = AssetSize()) {
+		std::unique_lock<std::shared_mutex> lock(m_Mutex);
+
+		if (!isCurrent(handle)) {
+			return;
+		}
+
+		Slot& slot = getSlot(handle.index);
+		slot.value = std::move(value);
+
+		m_Usage.cpu += size.cpu - slot.size.cpu;
+		m_Usage.gpu += size.gpu - slot.size.gpu;
+		slot.size = size;
+
+		slot.state.store(AssetState::READY, std::memory_order_release);
+	}
+
+	void fail(Handle<T> handle) {
+		std::unique_lock<std::shared_mutex> lock(m_Mutex);
+
+		if (isCurrent(handle)) {
+			getSlot(handle.index).state.store(AssetState::FAILED, std::memory_order_release);
+		}
+	}
+
+	void remove(Handle<T> handle) {
+		std::unique_lock<std::shared_mutex> lock(m_Mutex);
+
+		if (!isCurrent(handle)) {
+			return;
+		}
+
+		Slot& slot = getSlot(handle.index);
+		slot.state.store(AssetState::PENDING, std::memory_order_relaxed);
+		slot.generation.fetch_add(1, std::memory_order_release);
+		slot.value.reset();
+
+		m_Usage.cpu -= slot.size.cpu;
+		m_Usage.gpu -= slot.size.gpu;
+		slot.size = AssetSize();
+
+		// drop the name and all aliases
+		for (auto it = m_Names.begin(); it != m_Names.end();) {
+			it = it->second == handle ? m_Names.erase(it) : std::next(it);
+		}
+
+		m_Sources.erase(slot.source);
+		slot.name.clear();
+		slot.source.clear();
+
+		m_FreeSlots.push_back(handle.index);
+	}
+
+	// drops the value of a ready asset that has a source, its name and handles stay valid for loading it again
+	void evict(Handle<T> handle) {
+		std::unique_lock<std::shared_mutex> lock(m_Mutex);
+
+		if (!isCurrent(handle)) {
+			return;
+		}
+
+		Slot& slot = getSlot(handle.index);
+
+		if (slot.source.empty() || slot.state.load(std::memory_order_relaxed) != AssetState::READY) {
+			return;
+		}
+
+		slot.state.store(AssetState::EVICTED, std::memory_order_release);
+		slot.value.reset();
+
+		m_Usage.cpu -= slot.size.cpu;
+		m_Usage.gpu -= slot.size.gpu;
+		slot.size = AssetSize();
+	}
+
+	// never blocks, stale and invalid handles report FAILED
+	AssetState getState(Handle<T> handle) const {
+		if (!isCurrent(handle)) {
+			return AssetState::FAILED;
+		}
+
+		return getSlot(handle.index).state.load(std::memory_order_acquire);
+	}
+
+	bool contains(Handle<T> handle) const {
+		return getState(handle) == AssetState::READY;
+	}
+
+	// returns nullptr while the asset is not ready
+	T* tryGet(Handle<T> handle) {
+		if (!contains(handle)) {
+			return nullptr;
+		}
+
+		Slot& slot = getSlot(handle.index);
+		slot.lastUsed.store(m_Clock.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+		return &*slot.value;
+	}
+
+	T& get(Handle<T> handle) {
+		T* value = tryGet(handle);
+
+		if (value == nullptr) {
+			throw std::runtime_error("Invalid resource handle");
+		}
+
+		return *value;
+	}
+
+	T& get(const std::string& name) {
+		return get(require(name));
+	}
+
+	// returns an invalid handle if no resource with this name exists
+	Handle<T> find(const std::string& name) const {
+		std::shared_lock<std::shared_mutex> lock(m_Mutex);
+
+		auto it = m_Names.find(name);
+
+		return it != m_Names.end() ? it->second : Handle<T>();
+	}
+
+	Handle<T> require(const std::string& name) const {
+		Handle<T> handle = find(name);
+
+		if (!handle.isValid()) {
+			throw std::runtime_error("Unknown resource: " + name);
+		}
+
+		return handle;
+	}
+
+	void acquire(Handle<T> handle) {
+		if (isCurrent(handle)) {
+			getSlot(handle.index).refCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void release(Handle<T> handle) {
+		if (isCurrent(handle)) {
+			getSlot(handle.index).refCount.fetch_sub(1, std::memory_order_acq_rel);
+		}
+	}
+
+	// advances the clock used to find the least recently used assets
+	void tick() {
+		m_Clock.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	AssetSize getUsage() const {
+		std::shared_lock<std::shared_mutex> lock(m_Mutex);
+
+		return m_Usage;
+	}
+
+	// unreferenced ready asset with a source that has not been used for the longest time, invalid if there is none
+	Handle<T> findEvictable(uint64_t& lastUsed) const {
+		std::shared_lock<std::shared_mutex> lock(m_Mutex);
+
+		Handle<T> oldest;
+		lastUsed = UINT64_MAX;
+
+		for (uint32_t i = 0; i < m_Size.load(std::memory_order_acquire); i++) {
+			const Slot& slot = getSlot(i);
+
+			if (slot.state.load(std::memory_order_acquire) != AssetState::READY || slot.refCount.load(std::memory_order_acquire) > 0) {
+				continue;
+			}
+
+			// assets that were added from memory could never be loaded again
+			if (slot.source.empty()) {
+				continue;
+			}
+
+			uint64_t used = slot.lastUsed.load(std::memory_order_relaxed);
+
+			if (used < lastUsed) {
+				lastUsed = used;
+				oldest.index = i;
+				oldest.generation = slot.generation.load(std::memory_order_relaxed);
+			}
+		}
+
+		return oldest;
+	}
+
+	std::string getName(Handle<T> handle) const {
+		std::shared_lock<std::shared_mutex> lock(m_Mutex);
+
+		return isCurrent(handle) ? getSlot(handle.index).name : std::string();
+	}
+
+	std::string getSource(Handle<T> handle) const {
+		std::shared_lock<std::shared_mutex> lock(m_Mutex);
+
+		return isCurrent(handle) ? getSlot(handle.index).source : std::string();
+	}
+
+private:
+	struct Slot {
+		std::optional<T> value;
+		std::string name;
+		std::string source;
+		AssetSize size;
+		std::atomic<uint32_t> generation{0};
+		std::atomic<AssetState> state{AssetState::PENDING};
+		std::atomic<uint32_t> refCount{0};
+		std::atomic<uint64_t> lastUsed{0};
+	};
+
+	using Page = std::array<Slot, PAGE_SIZE>;
+
+	uint32_t allocateSlot() {
+		uint32_t index = m_Size.load(std::memory_order_relaxed);
+
+		if (index >= PAGE_SIZE * MAX_PAGES) {
+			throw std::runtime_error("Resource registry is full");
+		}
+
+		std::atomic<Page*>& page = m_Pages[index / PAGE_SIZE];
+
+		if (page.load(std::memory_order_relaxed) == nullptr) {
+			page.store(new Page(), std::memory_order_release);
+		}
+
+		m_Size.store(index + 1, std::memory_order_release);
+
+		return index;
+	}
+
+	bool isCurrent(Handle<T> handle) const {
+		return handle.index < m_Size.load(std::memory_order_acquire) && getSlot(handle.index).generation.load(std::memory_order_acquire) == handle.generation;
+	}
+
+	Slot& getSlot(uint32_t index) const {
+		return (*m_Pages[index / PAGE_SIZE].load(std::memory_order_acquire))[index % PAGE_SIZE];
+	}
+
+private:
+	std::array<std::atomic<Page*>, MAX_PAGES> m_Pages;
+	std::atomic<uint32_t> m_Size;
+
+	std::atomic<uint64_t> m_Clock{0};
+
+	mutable std::shared_mutex m_Mutex;
+	std::vector<uint32_t> m_FreeSlots;
+	std::unordered_map<std::string, Handle<T>> m_Names;
+	std::unordered_map<std::string, Handle<T>> m_Sources;
+	AssetSize m_Usage;
+};
+
+/**
+ * Reference counted handle, keeps the asset from being evicted while it is alive.
+ */
+template<typename T>
+class AssetRef {
+public:
+	AssetRef() : m_Registry(nullptr) {}
+
+	AssetRef(Registry<T>& registry, Handle<T> handle) : m_Registry(&registry), m_Handle(handle) {
+		m_Registry->acquire(m_Handle);
+	}
+
+	AssetRef(const AssetRef& other) : m_Registry(other.m_Registry), m_Handle(other.m_Handle) {
+		if (m_Registry != nullptr) {
+			m_Registry->acquire(m_Handle);
+		}
+	}
+
+	AssetRef& operator=(const AssetRef& other) {
+		if (this != &other) {
+			AssetRef copy(other);
+			swap(copy);
+		}
+		return *this;
+	}
+
+	AssetRef(AssetRef&& other) : m_Registry(other.m_Registry), m_Handle(other.m_Handle) {
+		other.m_Registry = nullptr;
+		other.m_Handle = Handle<T>();
+	}
+
+	AssetRef& operator=(AssetRef&& other) {
+		if (this != &other) {
+			AssetRef moved(std::move(other));
+			swap(moved);
+		}
+		return *this;
+	}
+
+	~AssetRef() {
+		if (m_Registry != nullptr) {
+			m_Registry->release(m_Handle);
+		}
+	}
+
+	Handle<T> getHandle() const { return m_Handle; }
+	bool isValid() const { return m_Handle.isValid(); }
+
+private:
+	void swap(AssetRef& other) {
+		std::swap(m_Registry, other.m_Registry);
+		std::swap(m_Handle, other.m_Handle);
+	}
+
+private:
+	Registry<T>* m_Registry;
+	Handle<T> m_Handle;
+};
+
+/**
+ * Evicts the least recently used unreferenced assets of two registries until their combined memory fits the budget.
+ * Stops early when everything left is referenced or cannot be loaded again.
+ */
+template<typename A, typename B>
+void evictToBudget(Registry<A>& first, Registry<B>& second, const AssetSize& budget) {
+	auto usage = [&]() {
+		AssetSize a = first.getUsage();
+		AssetSize b = second.getUsage();
+		return AssetSize{ a.cpu + b.cpu, a.gpu + b.gpu };
+	};
+
+	AssetSize current = usage();
+
+	while (current.cpu > budget.cpu || current.gpu > budget.gpu) {
+		uint64_t firstUsed, secondUsed;
+		Handle<A> firstHandle = first.findEvictable(firstUsed);
+		Handle<B> secondHandle = second.findEvictable(secondUsed);
+
+		if (!firstHandle.isValid() && !secondHandle.isValid()) {
+			break;
+		}
+
+		// names and sources are kept, the asset can be loaded again by name
+		if (firstUsed <= secondUsed) {
+			first.evict(firstHandle);
+		} else {
+			second.evict(secondHandle);
+		}
+
+		current = usage();
+	}
+}
@@ -0,0 +1,298 @@
+#include "renderer/impostor.hpp"
+
+#include "config.hpp"
+#include "framework/common.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+Impostor::Impostor()
+	: m_Center(glm::vec3(0.0f)), m_Radius(0.0f) {
+}
+
+Impostor::Atlas Impostor::bake(const std::vector<Mesh::VertexPCNT>& vertices, const std::vector<unsigned int>& indices, const Texture::Image* diffuse) {
+	Atlas atlas;
+	atlas.size = FRAMES * FRAME_SIZE;
+
+	// bounding sphere around the center of the bounding box
+	glm::vec3 min(std::numeric_limits<float>::max());
+	glm::vec3 max(std::numeric_limits<float>::lowest());
+
+	for (const Mesh::VertexPCNT& vertex : vertices) {
+		min = glm::min(min, vertex.position);
+		max = glm::max(max, vertex.position);
+	}
+
+	atlas.center = 0.5f * (min + max);
+
+	for (const Mesh::VertexPCNT& vertex : vertices) {
+		atlas.radius = std::max(atlas.radius, glm::length(vertex.position - atlas.center));
+	}
+
+	const size_t numPixels = static_cast<size_t>(atlas.size) * atlas.size;
+	atlas.albedo.assign(4 * numPixels, 0);
+	atlas.normal.assign(4 * numPixels, 0);
+	atlas.depth.assign(numPixels, 0.0f);
+
+	if (vertices.empty() || atlas.radius <= 0.0f) {
+		return atlas;
+	}
+
+	for (int y = 0; y < FRAMES; y++) {
+		for (int x = 0; x < FRAMES; x++) {
+			rasterizeFrame(atlas, getFrame(glm::ivec2(x, y)), vertices, indices, diffuse);
+		}
+	}
+
+	return atlas;
+}
+
+// file size and modification time stand in for the content, hashing the sources would cost as much as decoding them
+static uint64_t hashSource(const std::string& path, uint64_t hash) {
+	std::error_code error;
+	std::filesystem::path file(path);
+
+	hash = Common::fnv1a(std::filesystem::weakly_canonical(file, error).string() + '\n', hash);
+	hash = Common::fnv1a(std::to_string(std::filesystem::file_size(file, error)) + '\n', hash);
+	hash = Common::fnv1a(std::to_string(std::filesystem::last_write_time(file, error).time_since_epoch().count()) + '\n', hash);
+
+	return hash;
+}
+
+std::string Impostor::cachePath(const std::string& meshpath, const std::string& texturepath) {
+	uint64_t hash = Common::fnv1a(std::to_string(FRAMES) + 'x' + std::to_string(FRAME_SIZE) + '\n');
+	hash = hashSource(meshpath, hash);
+	hash = hashSource(texturepath, hash);
+
+	std::stringstream path;
+	path << Config::IMPOSTOR_CACHE_DIR << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+	return path.str();
+}
+
+bool Impostor::readAtlas(const std::string& filename, Atlas& atlas) {
+	std::ifstream stream(filename, std::ios::binary);
+	if (!stream.is_open()) {
+		return false;
+	}
+
+	stream.read(reinterpret_cast<char*>(&atlas.size), sizeof(atlas.size));
+	stream.read(reinterpret_cast<char*>(&atlas.center), sizeof(atlas.center));
+	stream.read(reinterpret_cast<char*>(&atlas.radius), sizeof(atlas.radius));
+
+	if (!stream || atlas.size != FRAMES * FRAME_SIZE) {
+		return false;
+	}
+
+	const size_t numPixels = static_cast<size_t>(atlas.size) * atlas.size;
+	atlas.albedo.resize(4 * numPixels);
+	atlas.normal.resize(4 * numPixels);
+	atlas.depth.resize(numPixels);
+
+	stream.read(reinterpret_cast<char*>(atlas.albedo.data()), atlas.albedo.size());
+	stream.read(reinterpret_cast<char*>(atlas.normal.data()), atlas.normal.size());
+	stream.read(reinterpret_cast<char*>(atlas.depth.data()), atlas.depth.size() * sizeof(float));
+
+	// a truncated file is baked again
+	return static_cast<bool>(stream);
+}
+
+void Impostor::writeAtlas(const std::string& filename, const Atlas& atlas) {
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+
+	std::ofstream stream(filename, std::ios::binary);
+	if (!stream.is_open()) {
+		return;
+	}
+
+	stream.write(reinterpret_cast<const char*>(&atlas.size), sizeof(atlas.size));
+	stream.write(reinterpret_cast<const char*>(&atlas.center), sizeof(atlas.center));
+	stream.write(reinterpret_cast<const char*>(&atlas.radius), sizeof(atlas.radius));
+	stream.write(reinterpret_cast<const char*>(atlas.albedo.data()), atlas.albedo.size());
+	stream.write(reinterpret_cast<const char*>(atlas.normal.data()), atlas.normal.size());
+	stream.write(reinterpret_cast<const char*>(atlas.depth.data()), atlas.depth.size() * sizeof(float));
+}
+
+glm::vec2 Impostor::octEncode(const glm::vec3& direction) {
+	glm::vec3 n = direction / (std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z));
+	glm::vec2 p(n.x, n.z);
+
+	// fold the lower hemisphere over the diagonals
+	if (n.y < 0.0f) {
+		p = glm::vec2(
+			(1.0f - std::abs(n.z)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - std::abs(n.x)) * (n.z >= 0.0f ? 1.0f : -1.0f));
+	}
+
+	return 0.5f * p + glm::vec2(0.5f);
+}
+
+glm::vec3 Impostor::octDecode(const glm::vec2& uv) {
+	glm::vec2 p = 2.0f * uv - glm::vec2(1.0f);
+	glm::vec3 n(p.x, 1.0f - std::abs(p.x) - std::abs(p.y), p.y);
+
+	if (n.y < 0.0f) {
+		float x = n.x;
+		n.x = (1.0f - std::abs(n.z)) * (x >= 0.0f ? 1.0f : -1.0f);
+		n.z = (1.0f - std::abs(x)) * (n.z >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	return glm::normalize(n);
+}
+
+Impostor::Frame Impostor::getFrame(const glm::ivec2& index) {
+	Frame frame;
+	frame.index = index;
+	frame.direction = octDecode((glm::vec2(index) + glm::vec2(0.5f)) / static_cast<float>(FRAMES));
+
+	glm::vec3 upRef = std::abs(frame.direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+	frame.right = glm::normalize(glm::cross(upRef, frame.direction));
+	frame.up = glm::cross(frame.direction, frame.right);
+
+	return frame;
+}
+
+Impostor::Frame Impostor::selectFrame(const glm::vec3& localViewDir) {
+	glm::vec2 uv = octEncode(localViewDir);
+	glm::ivec2 index(static_cast<int>(std::floor(uv.x * FRAMES)), static_cast<int>(std::floor(uv.y * FRAMES)));
+
+	index.x = std::clamp(index.x, 0, FRAMES - 1);
+	index.y = std::clamp(index.y, 0, FRAMES - 1);
+
+	return getFrame(index);
+}
+
+void Impostor::rasterizeFrame(Atlas& atlas, const Frame& frame, const std::vector<Mesh::VertexPCNT>& vertices, const std::vector<unsigned int>& indices, const Texture::Image* diffuse) {
+	// orthographic projection of all vertices into the frame: xy in pixels, z is the depth toward the viewer
+	std::vector<glm::vec3> projected(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); i++) {
+		glm::vec3 local = (vertices[i].position - atlas.center) / atlas.radius;
+
+		projected[i] = glm::vec3(
+			(glm::dot(local, frame.right) * 0.5f + 0.5f) * FRAME_SIZE,
+			(glm::dot(local, frame.up) * 0.5f + 0.5f) * FRAME_SIZE,
+			glm::dot(local, frame.direction));
+	}
+
+	std::vector<float> depthBuffer(FRAME_SIZE * FRAME_SIZE, std::numeric_limits<float>::lowest());
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		const glm::vec3& p0 = projected[indices[i + 0]];
+		const glm::vec3& p1 = projected[indices[i + 1]];
+		const glm::vec3& p2 = projected[indices[i + 2]];
+
+		float area = (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
+
+		if (std::abs(area) < 1e-8f) {
+			continue;
+		}
+
+		int minX = std::max(0, static_cast<int>(std::floor(std::min({ p0.x, p1.x, p2.x }))));
+		int maxX = std::min(FRAME_SIZE - 1, static_cast<int>(std::ceil(std::max({ p0.x, p1.x, p2.x }))));
+		int minY = std::max(0, static_cast<int>(std::floor(std::min({ p0.y, p1.y, p2.y }))));
+		int maxY = std::min(FRAME_SIZE - 1, static_cast<int>(std::ceil(std::max({ p0.y, p1.y, p2.y }))));
+
+		const Mesh::VertexPCNT& v0 = vertices[indices[i + 0]];
+		const Mesh::VertexPCNT& v1 = vertices[indices[i + 1]];
+		const Mesh::VertexPCNT& v2 = vertices[indices[i + 2]];
+
+		for (int y = minY; y <= maxY; y++) {
+			for (int x = minX; x <= maxX; x++) {
+				float px = x + 0.5f, py = y + 0.5f;
+
+				// barycentric coordinates, valid for both windings
+				float w0 = ((p1.x - px) * (p2.y - py) - (p2.x - px) * (p1.y - py)) / area;
+				float w1 = ((p2.x - px) * (p0.y - py) - (p0.x - px) * (p2.y - py)) / area;
+				float w2 = 1.0f - w0 - w1;
+
+				if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+					continue;
+				}
+
+				float depth = w0 * p0.z + w1 * p1.z + w2 * p2.z;
+				float& closest = depthBuffer[y * FRAME_SIZE + x];
+
+				if (depth <= closest) {
+					continue;
+				}
+
+				closest = depth;
+
+				size_t atlasX = frame.index.x * FRAME_SIZE + x;
+				size_t atlasY = frame.index.y * FRAME_SIZE + y;
+				size_t pixel = atlasY * atlas.size + atlasX;
+
+				// albedo
+				unsigned char* albedo = &atlas.albedo[4 * pixel];
+				albedo[0] = albedo[1] = albedo[2] = 255;
+				albedo[3] = 255;
+
+				if (diffuse != nullptr && diffuse->width > 0 && diffuse->height > 0) {
+					glm::vec2 texCoord = w0 * v0.texCoord + w1 * v1.texCoord + w2 * v2.texCoord;
+					texCoord -= glm::floor(texCoord);
+
+					int tx = std::min(diffuse->width - 1, static_cast<int>(texCoord.x * diffuse->width));
+					int ty = std::min(diffuse->height - 1, static_cast<int>(texCoord.y * diffuse->height));
+					const unsigned char* texel = &diffuse->pixels[4 * (static_cast<size_t>(ty) * diffuse->width + tx)];
+
+					albedo[0] = texel[0];
+					albedo[1] = texel[1];
+					albedo[2] = texel[2];
+				}
+
+				// normal
+				glm::vec3 normal = w0 * v0.normal + w1 * v1.normal + w2 * v2.normal;
+				normal = glm::length(normal) > 0.0f ? glm::normalize(normal) : frame.direction;
+
+				unsigned char* encoded = &atlas.normal[4 * pixel];
+				encoded[0] = static_cast<unsigned char>(std::lround((normal.x * 0.5f + 0.5f) * 255.0f));
+				encoded[1] = static_cast<unsigned char>(std::lround((normal.y * 0.5f + 0.5f) * 255.0f));
+				encoded[2] = static_cast<unsigned char>(std::lround((normal.z * 0.5f + 0.5f) * 255.0f));
+				encoded[3] = 255;
+
+				// depth
+				atlas.depth[pixel] = depth;
+			}
+		}
+	}
+}
+
+static void uploadAtlas(Texture& texture, GLint internalformat, GLenum format, GLenum type, int size, const void* data) {
+	texture.allocate(Texture::Type::TEX2D, internalformat, size, size, format, type, data);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void Impostor::load(const Atlas& atlas) {
+	m_Center = atlas.center;
+	m_Radius = atlas.radius;
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	uploadAtlas(m_AlbedoAtlas, GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE, atlas.size, atlas.albedo.data());
+	uploadAtlas(m_NormalAtlas, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, atlas.size, atlas.normal.data());
+	uploadAtlas(m_DepthAtlas, GL_R16F, GL_RED, GL_FLOAT, atlas.size, atlas.depth.data());
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	m_AlbedoAtlas.label("Impostors", "albedo atlas");
+	m_NormalAtlas.label("Impostors", "normal atlas");
+	m_DepthAtlas.label("Impostors", "depth atlas");
+}
+
+void Impostor::bind(GLuint firstUnit) {
+	m_AlbedoAtlas.bind(Texture::Type::TEX2D, firstUnit + 0);
+	m_NormalAtlas.bind(Texture::Type::TEX2D, firstUnit + 1);
+	m_DepthAtlas.bind(Texture::Type::TEX2D, firstUnit + 2);
+}
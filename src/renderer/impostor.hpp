@@ -0,0 +1,71 @@
+#pragma once
+
+#include "framework/mesh.hpp"
+#include "framework/gl/texture.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/**
+ * Octahedral impostor for distant static objects.
+ * The object is rendered from FRAMES x FRAMES view directions that are distributed over the sphere with an
+ * octahedral mapping. Every frame stores albedo, object space normal and depth, so a single quad can write
+ * consistent data into the G-buffer.
+ */
+class Impostor {
+public:
+	static constexpr int FRAMES = 8;
+	static constexpr int FRAME_SIZE = 64;
+
+	// Result of the CPU bake, does not require an OpenGL context
+	struct Atlas {
+		int size = 0;
+		glm::vec3 center = glm::vec3(0.0f);
+		float radius = 0.0f;
+		std::vector<unsigned char> albedo; // sRGB color + coverage, RGBA8
+		std::vector<unsigned char> normal; // object space normal mapped to [0, 1], RGBA8
+		std::vector<float> depth;          // offset along the frame direction in units of the radius
+	};
+
+	// Orientation of a single frame, shared by the baker and the runtime quad
+	struct Frame {
+		glm::ivec2 index;
+		glm::vec3 direction; // points from the object toward the viewer
+		glm::vec3 right;
+		glm::vec3 up;
+	};
+
+public:
+	Impostor();
+
+	static Atlas bake(const std::vector<Mesh::VertexPCNT>& vertices, const std::vector<unsigned int>& indices, const Texture::Image* diffuse);
+
+	// atlases are cached on disk, the path changes whenever the sources or the atlas layout do
+	static std::string cachePath(const std::string& meshpath, const std::string& texturepath);
+	static bool readAtlas(const std::string& filename, Atlas& atlas);
+	static void writeAtlas(const std::string& filename, const Atlas& atlas);
+
+	static glm::vec2 octEncode(const glm::vec3& direction);
+	static glm::vec3 octDecode(const glm::vec2& uv);
+	static Frame getFrame(const glm::ivec2& index);
+	static Frame selectFrame(const glm::vec3& localViewDir);
+
+	void load(const Atlas& atlas);
+	void bind(GLuint firstUnit);
+
+	const glm::vec3& getCenter() const { return m_Center; }
+	float getRadius() const { return m_Radius; }
+
+private:
+	static void rasterizeFrame(Atlas& atlas, const Frame& frame, const std::vector<Mesh::VertexPCNT>& vertices, const std::vector<unsigned int>& indices, const Texture::Image* diffuse);
+
+private:
+	glm::vec3 m_Center;
+	float m_Radius;
+
+	Texture m_AlbedoAtlas;
+	Texture m_NormalAtlas;
+	Texture m_DepthAtlas;
+};
@@ -2,7 +2,7 @@
 
 
 Light::Light()
-	: m_Color(glm::vec3(1.0f)) {
+	: m_Color(glm::vec3(1.0f)), m_Version(nextVersion()) {
 
 }
 
@@ -12,6 +12,16 @@ glm::vec3 Light::getColor() const {
 
 void Light::setColor(const glm::vec3& color) {
 	m_Color = color;
+	touch();
+}
+
+uint64_t Light::nextVersion() {
+	static uint64_t version = 0;
+	return ++version;
+}
+
+void Light::touch() {
+	m_Version = nextVersion();
 }
 
 
@@ -26,6 +36,7 @@ glm::vec3 DirLight::getDirection() const {
 
 void DirLight::setDirection(const glm::vec3& direction) {
 	m_Direction = glm::normalize(direction);
+	touch();
 }
 
 
@@ -56,6 +67,7 @@ float PointLight::getQuadratic() const {
 
 void PointLight::setPosition(const glm::vec3& position) {
 	m_Position = position;
+	touch();
 }
 
 void PointLight::setAttenuationFactors(float constant, float linear, float quadratic) {
@@ -67,4 +79,5 @@ void PointLight::setAttenuationFactors(float constant, float linear, float quadr
 	float lightMax = std::fmaxf(std::fmaxf(m_Color.r, m_Color.g), m_Color.b);
 
 	m_Radius = (-linear + std::sqrt(linear * linear - 4 * quadratic * (constant - (256.0 / 5.0) * lightMax))) / (2 * quadratic);
+	touch();
 }
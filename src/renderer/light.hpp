@@ -3,17 +3,27 @@
 #include <glm/glm.hpp>
 
 #include <cmath>
+#include <cstdint>
 
 class Light {
 public:
 	Light();
 
 	glm::vec3 getColor() const;
+	// stamp of the last change, larger than every stamp handed out before
+	uint64_t getVersion() const { return m_Version; }
 
 	void setColor(const glm::vec3& color);
 
+	// stamps are global, so the newest change of any light or scene has the largest one
+	static uint64_t nextVersion();
+
+protected:
+	void touch();
+
 protected:
 	glm::vec3 m_Color;
+	uint64_t m_Version;
 };
 
 class DirLight : public Light {
@@ -0,0 +1,108 @@
+#include "renderer/occlusionqueries.hpp"
+
+#include "framework/gl/glstate.hpp"
+
+static constexpr UniformName U_TO_CLIP("uToClip");
+// set for every queried box
+static const UniformSlot U_MIN("uMin");
+static const UniformSlot U_MAX("uMax");
+
+void OcclusionQueries::update() {
+	m_Frame++;
+
+	for (auto it = m_States.begin(); it != m_States.end();) {
+		State& state = it->second;
+
+		// removed objects and objects that left the pass stop being queried
+		if (state.pending == 0 && m_Frame - state.lastQueried > FORGET_AFTER) {
+			it = m_States.erase(it);
+			continue;
+		}
+
+		// results arrive in the order the queries were issued
+		while (state.pending > 0 && state.queries[state.oldest].isAvailable()) {
+			state.hidden = state.queries[state.oldest].getResult() ? 0 : state.hidden + 1;
+			state.oldest = (state.oldest + 1) % RING_SIZE;
+			state.pending--;
+		}
+
+		++it;
+	}
+}
+
+bool OcclusionQueries::isHidden(uint32_t proxy) const {
+	auto it = m_States.find(proxy);
+	return it != m_States.end() && it->second.hidden >= HIDE_AFTER;
+}
+
+void OcclusionQueries::begin(Program& program, Mesh& box, const glm::mat4& worldToClip) {
+	m_Program = &program;
+	m_Box = &box;
+	m_WorldToClip = worldToClip;
+
+	// shadow passes cull front faces, but only the front faces of a box lie in front of the object
+	m_CullFace = GLState::isEnabled(GL_CULL_FACE);
+	GLState::disable(GL_CULL_FACE);
+	GLState::depthMask(GL_FALSE);
+	GLState::colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+	m_Program->bind();
+	m_Program->set(U_TO_CLIP, m_WorldToClip);
+}
+
+bool OcclusionQueries::query(uint32_t proxy, const Bounds& bounds) {
+	State& state = m_States[proxy];
+	state.lastQueried = m_Frame;
+
+	if (state.pending == RING_SIZE || !bounds.isValid()) {
+		return false;
+	}
+
+	// a box that reaches through the near plane is clipped, the camera may even be inside of it
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 corner(i & 1 ? bounds.max.x : bounds.min.x, i & 2 ? bounds.max.y : bounds.min.y, i & 4 ? bounds.max.z : bounds.min.z);
+		glm::vec4 clip = m_WorldToClip * glm::vec4(corner, 1.0f);
+
+		if (clip.w <= 0.0f || clip.z < -clip.w) {
+			state.hidden = 0;
+			return false;
+		}
+	}
+
+	// pushed out a little, so surfaces of the object that touch the box don't hide it
+	glm::vec3 margin = 0.01f * bounds.extent() + glm::vec3(0.01f);
+	m_Program->set(U_MIN, bounds.min - margin);
+	m_Program->set(U_MAX, bounds.max + margin);
+
+	Query& query = state.queries[(state.oldest + state.pending) % RING_SIZE];
+	query.begin(Query::Type::ANY_SAMPLES_PASSED);
+	m_Box->draw();
+	query.end(Query::Type::ANY_SAMPLES_PASSED);
+	state.pending++;
+	state.issued = m_Frame;
+
+	return true;
+}
+
+void OcclusionQueries::end() {
+	GLState::colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	GLState::depthMask(GL_TRUE);
+	GLState::setEnabled(GL_CULL_FACE, m_CullFace);
+}
+
+bool OcclusionQueries::beginConditionalRender(uint32_t proxy) const {
+	auto it = m_States.find(proxy);
+
+	if (it == m_States.end() || it->second.pending == 0 || it->second.issued != m_Frame) {
+		return false;
+	}
+
+	// the GPU waits for the query it has just drawn, the CPU goes on submitting
+	const State& state = it->second;
+	state.queries[(state.oldest + state.pending - 1) % RING_SIZE].beginConditionalRender(Query::Wait::BY_REGION_WAIT);
+	return true;
+}
+
+void OcclusionQueries::endConditionalRender() const {
+	Query::endConditionalRender();
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "framework/bounds.hpp"
+#include "framework/mesh.hpp"
+#include "framework/gl/program.hpp"
+#include "framework/gl/query.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+/**
+ * Hardware occlusion queries for the expensive objects of one pass, e.g. the camera or a shadow map face.
+ * After the pass has drawn its geometry, the bounding box of every queried object is tested against the
+ * depth buffer with GL_ANY_SAMPLES_PASSED. Results are only read once the GPU reports them available,
+ * so whether an object is hidden is decided by earlier frames and the CPU never waits for the GPU.
+ *
+ * An object has to be hidden HIDE_AFTER times in a row before it counts as hidden, a single visible result
+ * brings it back. Every object keeps a ring of RING_SIZE queries, so a new one is issued every pass while
+ * older results are still in flight. Hidden objects are drawn under conditional rendering of this pass's query,
+ * so they appear without a frame of delay when they come into view.
+ *
+ * Objects are identified by their proxy in the scene's bounding volume tree, which stays the same while
+ * removing other objects moves them in memory.
+ */
+class OcclusionQueries {
+public:
+	static constexpr uint32_t HIDE_AFTER = 2;
+	static constexpr uint64_t FORGET_AFTER = 60; // frames without a query before the state of an object is dropped
+	static constexpr uint32_t RING_SIZE = 3;
+
+public:
+	// reads the results that are available, call once per frame before the pass
+	void update();
+	bool isHidden(uint32_t proxy) const;
+
+	// boxes are depth tested against the bound framebuffer without writing depth or color
+	void begin(Program& program, Mesh& box, const glm::mat4& worldToClip);
+	// returns false if no query was issued, because the whole ring is pending or the box reaches through the near plane
+	bool query(uint32_t proxy, const Bounds& bounds);
+	void end();
+
+	// returns false if the object was not queried this frame, it must not be drawn conditionally then
+	bool beginConditionalRender(uint32_t proxy) const;
+	void endConditionalRender() const;
+
+	size_t size() const { return m_States.size(); }
+
+private:
+	struct State {
+		std::array<Query, RING_SIZE> queries;
+		uint32_t oldest = 0;  // ring index of the oldest pending query
+		uint32_t pending = 0; // number of queries in flight
+		uint32_t hidden = 0;  // consecutive results without a visible sample
+		uint64_t lastQueried = 0;
+		uint64_t issued = 0; // frame of the newest query
+	};
+
+private:
+	std::unordered_map<uint32_t, State> m_States;
+
+	Program* m_Program = nullptr;
+	Mesh* m_Box = nullptr;
+	glm::mat4 m_WorldToClip = glm::mat4(1.0f);
+	uint64_t m_Frame = 0;
+	bool m_CullFace = true; // restored by end()
+};
\ No newline at end of file
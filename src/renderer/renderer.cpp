@@ -2,34 +2,61 @@
 
 #include "resourcemanager.hpp"
 #include "framework/common.hpp"
+#include "framework/gl/glstate.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <iostream>
 
+// feature bits of the lighting shader variants
+enum LightingFeature : uint32_t {
+	DIR_LIGHT = 1 << 0,
+	ENABLE_DSHADOWS = 1 << 1,
+	ENABLE_OSHADOWS = 1 << 2
+};
+
+// set every frame
+static constexpr UniformName U_SHADOW_TRANSFORM("uShadowTransform");
+static constexpr UniformName U_HORIZONTAL("uHorizontal");
+static constexpr UniformName U_EXPOSURE("uExposure");
+static constexpr UniformName U_GAMMA("uGamma");
+
 Renderer::Renderer(std::shared_ptr<MovingCamera> cam, const glm::vec2& resolution)
-	: m_Cam(cam), m_Resolution(resolution), m_Scene(nullptr), m_ShowCameraControlPoints(false) {
+	: m_Cam(cam), m_Resolution(resolution), m_Scene(nullptr),
+	m_CameraBlock(UniformBlocks::CAMERA), m_LightBlock(UniformBlocks::LIGHTS),
+	m_ShowCameraControlPoints(false),
+	m_LightingShaders("deferred_lighting.vert", "deferred_lighting.frag", { "DIR_LIGHT", "ENABLE_DSHADOWS", "ENABLE_OSHADOWS" }, { "NR_POINT_LIGHTS" }) {
 	generateTextures();
 
-	m_SimpleGeometryShader.load("simple_geometry.vert", "simple_geometry.frag");
-
-	m_DepthShader.load("depthshader.vert", "depthshader.frag");
+	// before any program links, MainApp's programs included
+	Program::setBlockBinding("CameraBlock", UniformBlocks::CAMERA);
+	Program::setBlockBinding("LightBlock", UniformBlocks::LIGHTS);
 
-	m_CubeDepthShader.load("cubedepthshader.vert", "cubedepthshader.geom", "cubedepthshader.frag");
+	m_CameraBlock.stream.label("Uniform buffers", "camera block");
+	m_LightBlock.stream.label("Uniform buffers", "light block");
 
-	m_LightingShader.load("deferred_lighting.vert", "deferred_lighting.frag");
-	m_LightingShader.bindTextureUnit("uPosition", 0);
-	m_LightingShader.bindTextureUnit("uNormal", 1);
-	m_LightingShader.bindTextureUnit("uAlbedoSpec", 2);
-	m_LightingShader.bindTextureUnit("uDShadowMap", 3);
-	m_LightingShader.bindTextureUnit("uOShadowMap", 4);
+	// programs compile in the background while the remaining resources load, see initPrograms()
+	const std::vector<std::string> instanced = { "INSTANCED" };
 
+	m_SimpleGeometryShader.load("simple_geometry.vert", "simple_geometry.frag");
+	m_ImpostorShader.load("impostor.vert", "impostor.frag");
+	m_DepthShader.load("depthshader.vert", "depthshader.frag");
+	m_DepthShaderInstanced.load("depthshader.vert", "depthshader.frag", instanced);
+	m_CubeDepthShader.load("cubedepthshader.vert", "cubedepthshader.frag");
+	m_CubeDepthShaderInstanced.load("cubedepthshader.vert", "cubedepthshader.frag", instanced);
 	m_BlurShader.load("blurshader.vert", "blurshader.frag");
-	m_BlurShader.bindTextureUnit("uColorBuffer", 1);
-
 	m_HdrShader.load("hdrshader.vert", "hdrshader.frag");
-	m_HdrShader.bindTextureUnit("uHdrBuffer", 0);
-	m_HdrShader.bindTextureUnit("uBloomBuffer", 1);
+	m_OcclusionBoxShader.load("occlusionbox.vert", "occlusionbox.frag");
+
+	// lighting variants are compiled for the light setup of each scene when it is first set
+	m_LightingShaders.setInitializer([](Program& program) {
+		program.bindTextureUnit("uPosition", 0);
+		program.bindTextureUnit("uNormal", 1);
+		program.bindTextureUnit("uAlbedoSpec", 2);
+		program.bindTextureUnit("uDShadowMap", 3);
+		program.bindTextureUnit("uOShadowMap", 4);
+	});
 
 	// screen size quad
 	const std::vector<Mesh::VertexPCN> vertices = {
@@ -43,6 +70,24 @@ Renderer::Renderer(std::shared_ptr<MovingCamera> cam, const glm::vec2& resolutio
 
 	m_Quad.load(vertices, indices);
 
+	// unit cube, the occlusion queries stretch it over the bounds of an object
+	std::vector<Mesh::VertexPCN> boxVertices;
+
+	for (int i = 0; i < 8; i++) {
+		boxVertices.push_back({ glm::vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1), glm::vec2(0.0f), glm::vec3(1.0f) });
+	}
+
+	const std::vector<unsigned int> boxIndices = {
+		0, 2, 1, 1, 2, 3, // -z
+		4, 5, 6, 5, 7, 6, // +z
+		0, 1, 4, 1, 5, 4, // -y
+		2, 6, 3, 3, 6, 7, // +y
+		0, 4, 2, 2, 4, 6, // -x
+		1, 3, 5, 3, 7, 5  // +x
+	};
+
+	m_Box.load(boxVertices, boxIndices);
+
 	ResourceManager::loadMesh("meshes/highpolysphere.obj", "sphere");
 }
 
@@ -52,7 +97,36 @@ void Renderer::update(float dt) {
 	}
 }
 
+void Renderer::initPrograms() {
+	m_ImpostorShader.bindTextureUnit("uAlbedoAtlas", 0);
+	m_ImpostorShader.bindTextureUnit("uNormalAtlas", 1);
+	m_ImpostorShader.bindTextureUnit("uDepthAtlas", 2);
+	m_ImpostorShader.set("uFrames", Impostor::FRAMES);
+
+	m_BlurShader.bindTextureUnit("uColorBuffer", 1);
+
+	m_HdrShader.bindTextureUnit("uHdrBuffer", 0);
+	m_HdrShader.bindTextureUnit("uBloomBuffer", 1);
+
+	m_ProgramsInitialized = true;
+}
+
 void Renderer::draw() {
+	if (!m_ProgramsInitialized) {
+		initPrograms();
+	}
+
+	m_Stats = RenderStats();
+
+	// only re-upload lights that changed since the last frame
+	if (m_Scene->getLightsVersion() != m_LightsVersion) {
+		updateLightingUniforms();
+	}
+
+	updateSkinningPalette(*m_Scene);
+	// after the skinning palette, so animated bounds follow the current pose
+	m_Scene->updateBounds();
+
 	// only calculate shadow map if scene has a directional light
 	if (m_Scene->getDirLight().has_value()) {
 		directionalShadowPass(*m_Scene);
@@ -71,15 +145,72 @@ void Renderer::draw() {
 	hdrPass(blurBuffer, m_Exposure, m_Gamma);
 }
 
-size_t Renderer::addProgram(std::shared_ptr<Program> program) {
+void Renderer::updateSkinningPalette(Scene& scene) {
+	m_SkinningPalette.clear();
+
+	for (std::vector<RenderObject>& renderObjects : scene.getRenderObjects()) {
+		for (RenderObject& renderObject : renderObjects) {
+			if (const Animator* animator = renderObject.getAnimator()) {
+				m_SkinningPalette.add(*animator);
+			}
+		}
+	}
+
+	// a single upload for all animated instances, the palettes move with every frame's range of the stream
+	m_SkinningPalette.upload();
+	m_SkinningPalette.bind();
+
+	for (std::vector<RenderObject>& renderObjects : scene.getRenderObjects()) {
+		for (RenderObject& renderObject : renderObjects) {
+			if (const Animator* animator = renderObject.getAnimator()) {
+				renderObject.setPalette(m_SkinningPalette.getBase() + m_SkinningPalette.add(*animator));
+			}
+		}
+	}
+}
+
+void Renderer::gatherVisibility(Scene& scene, const Frustum& frustum) {
+	m_Visibility.clear();
+	scene.query(frustum, [this](RenderObject& object, size_t programId, const Bounds& bounds, uint32_t proxy) {
+		m_Visibility.add(object, programId, bounds, proxy);
+	});
+}
+
+void Renderer::gatherVisibility(Scene& scene, const glm::vec3& center, float radius) {
+	m_Visibility.clear();
+	scene.query(center, radius, [this](RenderObject& object, size_t programId, const Bounds& bounds, uint32_t proxy) {
+		m_Visibility.add(object, programId, bounds, proxy);
+	});
+}
+
+void Renderer::rasterizeOccluders(const std::vector<uint32_t>& visible) {
+	m_Occlusion.clear(m_Cam->projection() * m_Cam->view());
+
+	for (uint32_t index : visible) {
+		RenderObject& object = *m_Visibility[index].object;
+
+		if (object.getOccluder().isValid()) {
+			m_Occlusion.rasterize(ResourceManager::getOccluder(object.getOccluder()), object.getModelMatrix());
+		}
+	}
+
+	m_Occlusion.finish();
+}
+
+size_t Renderer::addProgram(std::shared_ptr<Program> program, std::shared_ptr<Program> instanced) {
 	size_t id = m_Programs.size();
 
 	m_Programs.push_back(program);
+	m_InstancedPrograms.push_back(instanced);
 
 	return id;
 }
 
 void Renderer::setScene(std::shared_ptr<Scene> scene) {
+	if (scene == m_Scene) {
+		return;
+	}
+
 	m_Scene = scene;
 
 	updateLightingUniforms();
@@ -99,12 +230,14 @@ void Renderer::showCameraControlPoints(bool showPoints) {
 }
 
 void Renderer::updateLightingUniforms() {
+	UniformBlocks::LightBlock lights{};
+
 	// directional light
 	if (m_Scene->getDirLight().has_value()) {
 		DirLight& dirLight = m_Scene->getDirLight().value();
 
-		m_LightingShader.set("uDirLight.direction", dirLight.getDirection());
-		m_LightingShader.set("uDirLight.color", dirLight.getColor());
+		lights.dirLight.direction = dirLight.getDirection();
+		lights.dirLight.color = dirLight.getColor();
 
 		float nearPlane = 1.0f, farPlane = 50.0f;
 		float borderSize = 40.0f;
@@ -112,13 +245,8 @@ void Renderer::updateLightingUniforms() {
 		glm::mat4 lightProjection = glm::ortho(-borderSize, borderSize, -borderSize, borderSize, nearPlane, farPlane);
 		glm::mat4 lightView = glm::lookAt(camDist * dirLight.getDirection(), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
-		glm::mat4 lightSpaceMatrix = lightProjection * lightView;
-
-		m_DepthShader.set("uLightSpaceMatrix", lightSpaceMatrix);
-		m_LightingShader.set("uLightSpaceMatrix", lightSpaceMatrix);
-	} else {
-		m_LightingShader.set("uDirLight.direction", glm::vec3(1.0f));
-		m_LightingShader.set("uDirLight.color", glm::vec3(0.0f));
+		m_LightSpaceMatrix = lightProjection * lightView;
+		lights.lightSpaceMatrix = m_LightSpaceMatrix;
 	}
 
 	// omni directional light
@@ -127,97 +255,108 @@ void Renderer::updateLightingUniforms() {
 
 		float aspectRatio = static_cast<float>(SHADOW_WIDTH) / static_cast<float>(SHADOW_HEIGHT);
 		float near = 0.75f;
-		float far = 25.0f;
+		float far = m_OShadowFar;
 		glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), aspectRatio, near, far);
 
-		std::vector<glm::mat4> shadowTransforms(6);
-		shadowTransforms[0] = shadowProj * glm::lookAt(light.getPosition(), light.getPosition() + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // front
-		shadowTransforms[1] = shadowProj * glm::lookAt(light.getPosition(), light.getPosition() + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // back
-		shadowTransforms[2] = shadowProj * glm::lookAt(light.getPosition(), light.getPosition() + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)); // up
-		shadowTransforms[3] = shadowProj * glm::lookAt(light.getPosition(), light.getPosition() + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)); // down
-		shadowTransforms[4] = shadowProj * glm::lookAt(light.getPosition(), light.getPosition() + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // right
-		shadowTransforms[5] = shadowProj * glm::lookAt(light.getPosition(), light.getPosition() + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // left
-
-		m_CubeDepthShader.set("uFar", far);
-		m_CubeDepthShader.set("uLightPosition", light.getPosition());
-		m_LightingShader.set("uFar", far);
-		m_LightingShader.set("uShadowLightPos", light.getPosition());
-
-		for (uint32_t i = 0; i < 6; i++) {
-			m_CubeDepthShader.set("uShadowTransforms[" + std::to_string(i) + "]", shadowTransforms[i]);
-		}
+		m_ShadowTransforms[0] = shadowProj * glm::lookAt(light.getPosition(), light.getPosition() + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // front
+		m_ShadowTransforms[1] = shadowProj * glm::lookAt(light.getPosition(), light.getPosition() + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // back
+		m_ShadowTransforms[2] = shadowProj * glm::lookAt(light.getPosition(), light.getPosition() + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)); // up
+		m_ShadowTransforms[3] = shadowProj * glm::lookAt(light.getPosition(), light.getPosition() + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)); // down
+		m_ShadowTransforms[4] = shadowProj * glm::lookAt(light.getPosition(), light.getPosition() + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // right
+		m_ShadowTransforms[5] = shadowProj * glm::lookAt(light.getPosition(), light.getPosition() + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // left
+
+		lights.shadowLightPosition = light.getPosition();
+		lights.far = far;
 	}
 
-	// point lights
-	for (size_t i = 0; i < m_Scene->getPointLights().size(); i++) {
+	// point lights, the lighting shader variant only reads the lights the scene has
+	for (size_t i = 0; i < m_Scene->getPointLights().size() && i < UniformBlocks::MAX_POINT_LIGHTS; i++) {
 		PointLight& pointLight = m_Scene->getPointLight(i);
 
-		m_LightingShader.set("uPointLights[" + std::to_string(i) + "].position", pointLight.getPosition());
-		m_LightingShader.set("uPointLights[" + std::to_string(i) + "].color", pointLight.getColor());
-		m_LightingShader.set("uPointLights[" + std::to_string(i) + "].radius", pointLight.getRadius());
-		m_LightingShader.set("uPointLights[" + std::to_string(i) + "].constant", pointLight.getConstant());
-		m_LightingShader.set("uPointLights[" + std::to_string(i) + "].linear", pointLight.getLinear());
-		m_LightingShader.set("uPointLights[" + std::to_string(i) + "].quadratic", pointLight.getQuadratic());
+		lights.pointLights[i].position = pointLight.getPosition();
+		lights.pointLights[i].color = pointLight.getColor();
+		lights.pointLights[i].radius = pointLight.getRadius();
+		lights.pointLights[i].constant = pointLight.getConstant();
+		lights.pointLights[i].linear = pointLight.getLinear();
+		lights.pointLights[i].quadratic = pointLight.getQuadratic();
 	}
 
-	// add dummy lights
-	for (size_t i = m_Scene->getPointLights().size(); i < m_Scene->MAX_NR_LIGHTS; i++) {
-		m_LightingShader.set("uPointLights[" + std::to_string(i) + "].position", glm::vec3(0.0f));
-		m_LightingShader.set("uPointLights[" + std::to_string(i) + "].color", glm::vec3(0.0f));
-		m_LightingShader.set("uPointLights[" + std::to_string(i) + "].radius", 0.0f);
-		m_LightingShader.set("uPointLights[" + std::to_string(i) + "].constant", 1.0f);
-		m_LightingShader.set("uPointLights[" + std::to_string(i) + "].linear", 0.0f);
-		m_LightingShader.set("uPointLights[" + std::to_string(i) + "].quadratic", 0.0f);
-	}
+	m_LightBlock.upload(lights);
+	m_LightsVersion = m_Scene->getLightsVersion();
 }
 
 void Renderer::updateCamUniforms() {
-	m_SimpleGeometryShader.set("uWorldToClip", m_Cam->projection() * m_Cam->view());
+	UniformBlocks::CameraBlock camera{};
+	camera.worldToClip = m_Cam->projection() * m_Cam->view();
+	camera.position = m_Cam->getPosition();
 
-	for (size_t i = 0; i < m_Programs.size(); i++) {
-		updateCamUniforms(i);
-	}
+	m_CameraBlock.upload(camera);
 }
 
-void Renderer::updateCamUniforms(size_t programId) {
-	std::shared_ptr<Program> program = m_Programs[programId];
+Program& Renderer::getLightingShader(bool enableDShadows, bool enableOShadows) {
+	uint32_t features = 0;
 
-	program->set("uWorldToClip", m_Cam->projection() * m_Cam->view());
+	if (m_Scene->getDirLight().has_value()) features |= DIR_LIGHT;
+	if (enableDShadows) features |= ENABLE_DSHADOWS;
+	if (enableOShadows) features |= ENABLE_OSHADOWS;
+
+	// NR_POINT_LIGHTS sizes the loop over the light block, it must not run past MAX_POINT_LIGHTS
+	size_t pointLights = std::min(m_Scene->getPointLights().size(), UniformBlocks::MAX_POINT_LIGHTS);
+
+	return m_LightingShaders.get(features, { static_cast<unsigned int>(pointLights) });
 }
 
 void Renderer::directionalShadowPass(Scene& scene) {
-	glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+	GLState::viewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
 	m_DShadowBuffer.bind();
-	glEnable(GL_DEPTH_TEST);
+	GLState::enable(GL_DEPTH_TEST);
 	glClear(GL_DEPTH_BUFFER_BIT);
-	glCullFace(GL_FRONT);
-	
-	drawScene(scene, m_DepthShader);
+	GLState::cullFace(GL_FRONT);
+
+	// the light looks along the opposite of its direction with an orthographic projection
+	glm::vec4 viewDirection = glm::vec4(-scene.getDirLight()->getDirection(), 0.0f);
+
+	gatherVisibility(scene, Frustum(m_LightSpaceMatrix));
+	drawScene(scene, m_DepthShader, m_DepthShaderInstanced, { m_LightSpaceMatrix, viewDirection, true }, m_DShadowQueries);
 
-	glViewport(0, 0, m_Resolution.x, m_Resolution.y);
-	glCullFace(GL_BACK);
+	GLState::viewport(0, 0, m_Resolution.x, m_Resolution.y);
+	GLState::cullFace(GL_BACK);
 }
 
 void Renderer::omnidirectionalShadowPass(Scene& scene) {
-	glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+	GLState::viewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
 	m_OShadowBuffer.bind();
-	glEnable(GL_DEPTH_TEST);
-	glClear(GL_DEPTH_BUFFER_BIT);
-	glCullFace(GL_FRONT);
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::cullFace(GL_FRONT);
+
+	glm::vec4 lightPosition = glm::vec4(scene.getPointLight(0).getPosition(), 1.0f);
+
+	// casters within the light's range, every face culls them against its own frustum
+	gatherVisibility(scene, glm::vec3(lightPosition), m_OShadowFar);
+
+	// render every face on its own, so meshlets can be culled against each face frustum
+	for (uint32_t i = 0; i < 6; i++) {
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_OShadowCubeMap.handle, 0);
+		glClear(GL_DEPTH_BUFFER_BIT);
 
-	drawScene(scene, m_CubeDepthShader);
+		m_CubeDepthShader.set(U_SHADOW_TRANSFORM, m_ShadowTransforms[i]);
+		m_CubeDepthShaderInstanced.set(U_SHADOW_TRANSFORM, m_ShadowTransforms[i]);
 
-	glViewport(0, 0, m_Resolution.x, m_Resolution.y);
-	glCullFace(GL_BACK);
+		drawScene(scene, m_CubeDepthShader, m_CubeDepthShaderInstanced, { m_ShadowTransforms[i], lightPosition, true }, m_OShadowQueries[i]);
+	}
+
+	GLState::viewport(0, 0, m_Resolution.x, m_Resolution.y);
+	GLState::cullFace(GL_BACK);
 }
 
 void Renderer::geometryPass(Scene& scene) {
 	m_GBuffer.bind();
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::enable(GL_BLEND);
 	glClearColor(0.2f, 0.3f, 0.8f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+	gatherVisibility(scene, m_Cam->frustum());
 	drawScene(scene);
 
 	if (scene.getParticleSystem().has_value()) {
@@ -238,8 +377,8 @@ void Renderer::geometryPass(Scene& scene) {
 
 void Renderer::lightingPass(bool enableDShadows, bool enableOShadows) {
 	m_ColorBuffer.bind();
-	glDisable(GL_DEPTH_TEST);
-	glDisable(GL_BLEND);
+	GLState::disable(GL_DEPTH_TEST);
+	GLState::disable(GL_BLEND);
 	glClear(GL_COLOR_BUFFER_BIT);
 
 	m_GPosition.bind(Texture::Type::TEX2D, 0);
@@ -248,10 +387,7 @@ void Renderer::lightingPass(bool enableDShadows, bool enableOShadows) {
 	m_DShadowMap.bind(Texture::Type::TEX2D, 3);
 	m_OShadowCubeMap.bind(Texture::Type::CUBE_MAP, 4);
 
-	m_LightingShader.set("uCamPos", m_Cam->getPosition());
-	m_LightingShader.set("uEnableDShadows", enableDShadows);
-	m_LightingShader.set("uEnableOShadows", enableOShadows);
-	m_LightingShader.bind();
+	getLightingShader(enableDShadows, enableOShadows).bind();
 
 	m_Quad.draw();
 }
@@ -260,7 +396,7 @@ int Renderer::blurPass(int amount) {
 	bool horizontal = true, firstIteration = true;
 
 	m_BlurShader.bind();
-	glDisable(GL_DEPTH_TEST);
+	GLState::disable(GL_DEPTH_TEST);
 
 	for (size_t i = 0; i < amount; i++) {
 		int framebufferIdx = static_cast<int>(horizontal);
@@ -268,7 +404,7 @@ int Renderer::blurPass(int amount) {
 		m_BlurFramebuffers[framebufferIdx].bind();
 		glClear(GL_COLOR_BUFFER_BIT);
 
-		m_BlurShader.set("uHorizontal", horizontal);
+		m_BlurShader.set(U_HORIZONTAL, horizontal);
 
 		if (firstIteration) {
 			m_BrightColorTexture.bind(Texture::Type::TEX2D, 1);
@@ -289,36 +425,175 @@ int Renderer::blurPass(int amount) {
 
 void Renderer::hdrPass(int blurBuffer, float exposure, float gamma) {
 	Framebuffer::bindDefault();
-	glDisable(GL_DEPTH_TEST);
+	GLState::disable(GL_DEPTH_TEST);
 	glClear(GL_COLOR_BUFFER_BIT);
 
 	m_ColorTexture.bind(Texture::Type::TEX2D, 0);
 	m_BlurTextures[blurBuffer].bind(Texture::Type::TEX2D, 1);
 
-	m_HdrShader.set("uExposure", exposure);
-	m_HdrShader.set("uGamma", gamma);
+	m_HdrShader.set(U_EXPOSURE, exposure);
+	m_HdrShader.set(U_GAMMA, gamma);
 	m_HdrShader.bind();
 
 	m_Quad.draw();
 }
 
 void Renderer::drawScene(Scene& scene) {
-	for (size_t i = 0; i < m_Programs.size(); i++) {
-		std::shared_ptr<Program> program = m_Programs[i];
+	const glm::vec3 camPos = m_Cam->getPosition();
+	Mesh::View view = { m_Cam->projection() * m_Cam->view(), glm::vec4(camPos, 1.0f), false };
 
-		// draw all render objects that use this shader
-		for (RenderObject& object : scene.getRenderObjects(i)) {
-			object.draw(*program);
+	const std::vector<uint32_t>& visible = m_Visibility.cull(m_Cam->frustum());
+
+	if (m_OcclusionCulling) {
+		rasterizeOccluders(visible);
+	}
+
+	m_CameraQueries.update();
+	m_Queue.clear();
+	m_Queried.clear();
+	m_Hidden.clear();
+	size_t occluded = 0;
+
+	// visible render objects of all shaders, distant ones as impostors
+	for (uint32_t index : visible) {
+		const VisibilityList::Entry& entry = m_Visibility[index];
+
+		if (m_OcclusionCulling && !m_Occlusion.isVisible(entry.bounds)) {
+			occluded++;
+			continue;
+		}
+
+		if (!submitQueried(m_CameraQueries, index)) {
+			occluded++;
+			continue;
 		}
+
+		RenderObject& object = *entry.object;
+		float depth = glm::distance(object.getWorldPosition(), camPos);
+
+		if (object.useImpostor(camPos)) {
+			m_Queue.submit(RenderQueue::Pass::IMPOSTOR, 0, m_ImpostorShader, nullptr, object, depth);
+		} else {
+			m_Queue.submit(RenderQueue::Pass::OPAQUE, entry.program, *m_Programs[entry.program], m_InstancedPrograms[entry.program].get(), object, depth);
+		}
+	}
+
+	m_Stats.objects += visible.size() - occluded;
+	m_Stats.culled += scene.getTree().size() - visible.size();
+	m_Stats.occluded += occluded;
+
+	m_Queue.sort();
+	m_Stats += m_Queue.execute(view, camPos, m_Quad);
+
+	issueQueries(m_CameraQueries, view.toClip);
+
+	// hidden objects are drawn if this frame's query finds them visible after all
+	RenderState state;
+
+	for (uint32_t index : m_Hidden) {
+		const VisibilityList::Entry& entry = m_Visibility[index];
+		RenderObject& object = *entry.object;
+
+		if (!m_CameraQueries.beginConditionalRender(entry.proxy)) {
+			continue;
+		}
+
+		if (object.useImpostor(camPos)) {
+			object.drawImpostor(m_ImpostorShader, m_Quad, camPos, state);
+		} else {
+			object.draw(*m_Programs[entry.program], view, state);
+		}
+
+		m_CameraQueries.endConditionalRender();
+		state.stats.conditional++;
 	}
+
+	m_Stats += state.stats;
 }
 
-void Renderer::drawScene(Scene& scene, Program& program) {
-	for (size_t i = 0; i < m_Programs.size(); i++) {
-		for (RenderObject& object : scene.getRenderObjects(i)) {
-			object.draw(program);
+void Renderer::drawScene(Scene& scene, Program& program, Program& instanced, const Mesh::View& view, OcclusionQueries& queries) {
+	const glm::vec3 eye = glm::vec3(view.eye);
+
+	// the light matrices map world space to clip space, so their planes apply to the world space bounds
+	const std::vector<uint32_t>& visible = m_Visibility.cull(Frustum(view.toClip));
+
+	queries.update();
+	m_Queue.clear();
+	m_Queried.clear();
+	m_Hidden.clear();
+	size_t occluded = 0;
+
+	for (uint32_t index : visible) {
+		// a caster that the light can't see only throws shadows onto other casters
+		if (!submitQueried(queries, index)) {
+			occluded++;
+			continue;
+		}
+
+		RenderObject& object = *m_Visibility[index].object;
+
+		// orthographic views have no eye to sort by, mesh order is enough for depth only passes
+		float depth = view.eye.w != 0.0f ? glm::distance(object.getWorldPosition(), eye) : 0.0f;
+		m_Queue.submit(RenderQueue::Pass::OPAQUE, 0, program, &instanced, object, depth);
+	}
+
+	m_Stats.objects += visible.size() - occluded;
+	m_Stats.culled += scene.getTree().size() - visible.size();
+	m_Stats.occluded += occluded;
+
+	m_Queue.sort();
+	m_Stats += m_Queue.execute(view, eye, m_Quad);
+
+	issueQueries(queries, view.toClip);
+
+	RenderState state;
+
+	for (uint32_t index : m_Hidden) {
+		RenderObject& object = *m_Visibility[index].object;
+
+		if (!queries.beginConditionalRender(m_Visibility[index].proxy)) {
+			continue;
+		}
+
+		object.draw(program, view, state);
+		queries.endConditionalRender();
+		state.stats.conditional++;
+	}
+
+	m_Stats += state.stats;
+}
+
+bool Renderer::submitQueried(OcclusionQueries& queries, uint32_t index) {
+	if (!m_OcclusionQueries || !m_Visibility[index].object->hasOcclusionQuery()) {
+		return true;
+	}
+
+	m_Queried.push_back(index);
+
+	if (queries.isHidden(m_Visibility[index].proxy)) {
+		m_Hidden.push_back(index);
+		return false;
+	}
+
+	return true;
+}
+
+void Renderer::issueQueries(OcclusionQueries& queries, const glm::mat4& toClip) {
+	if (m_Queried.empty()) {
+		return;
+	}
+
+	queries.begin(m_OcclusionBoxShader, m_Box, toClip);
+
+	for (uint32_t index : m_Queried) {
+		const VisibilityList::Entry& entry = m_Visibility[index];
+
+		if (queries.query(entry.proxy, entry.bounds)) {
+			m_Stats.queries++;
 		}
 	}
+
+	queries.end();
 }
 
 void Renderer::generateTextures() {
@@ -326,6 +601,7 @@ void Renderer::generateTextures() {
 	m_DShadowBuffer.bind();
 
 	generateTexture(m_DShadowMap, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, GL_FLOAT, glm::vec2(SHADOW_WIDTH, SHADOW_HEIGHT));
+	m_DShadowMap.label("Shadow maps", "directional");
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_DShadowMap.handle, 0);
 	glDrawBuffer(GL_NONE);
 	glReadBuffer(GL_NONE);
@@ -333,17 +609,15 @@ void Renderer::generateTextures() {
 	// omnidirectional shadows
 	m_OShadowBuffer.bind();
 
-	m_OShadowCubeMap.bind(Texture::Type::CUBE_MAP);
+	m_OShadowCubeMap.allocate(Texture::Type::CUBE_MAP, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, GL_DEPTH_COMPONENT, GL_FLOAT);
+	m_OShadowCubeMap.label("Shadow maps", "omnidirectional");
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	for (uint32_t i = 0; i < 6; i++) {
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-	}
 
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_OShadowCubeMap.handle, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X, m_OShadowCubeMap.handle, 0);
 	glDrawBuffer(GL_NONE);
 	glReadBuffer(GL_NONE);
 
@@ -351,15 +625,19 @@ void Renderer::generateTextures() {
 	m_GBuffer.bind();
 
 	generateTexture(m_GPosition, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+	m_GPosition.label("G-buffer", "position");
 	m_GBuffer.attach(Framebuffer::Type::READ_AND_DRAW, Framebuffer::Attachment::COLOR0, m_GPosition.handle);
 
 	generateTexture(m_GNormal, GL_RGBA16_SNORM, GL_RGBA, GL_FLOAT);
+	m_GNormal.label("G-buffer", "normal");
 	m_GBuffer.attach(Framebuffer::Type::READ_AND_DRAW, Framebuffer::Attachment::COLOR1, m_GNormal.handle);
 
 	generateTexture(m_GAlbdedoSpec, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+	m_GAlbdedoSpec.label("G-buffer", "albedo/specular");
 	m_GBuffer.attach(Framebuffer::Type::READ_AND_DRAW, Framebuffer::Attachment::COLOR2, m_GAlbdedoSpec.handle);
 
 	generateTexture(m_GDepth, GL_DEPTH32F_STENCIL8, GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV);
+	m_GDepth.label("G-buffer", "depth/stencil");
 	m_GBuffer.attach(Framebuffer::Type::READ_AND_DRAW, Framebuffer::Attachment::DEPTH, m_GDepth.handle);
 
 	std::array<GLenum, 3> drawGeomBuffers = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
@@ -369,10 +647,12 @@ void Renderer::generateTextures() {
 	m_ColorBuffer.bind();
 
 	generateTexture(m_ColorTexture, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+	m_ColorTexture.label("HDR targets", "color");
 	m_ColorBuffer.attach(Framebuffer::Type::READ_AND_DRAW, Framebuffer::Attachment::COLOR0, m_ColorTexture.handle);
 
 	// only bright fragment colors
 	generateTexture(m_BrightColorTexture, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+	m_BrightColorTexture.label("HDR targets", "bright color");
 	m_ColorBuffer.attach(Framebuffer::Type::READ_AND_DRAW, Framebuffer::Attachment::COLOR1, m_BrightColorTexture.handle);
 
 	std::array<GLenum, 2> drawBuffers = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
@@ -383,6 +663,7 @@ void Renderer::generateTextures() {
 		m_BlurFramebuffers[i].bind();
 
 		generateTexture(m_BlurTextures[i], GL_RGBA16F, GL_RGBA, GL_FLOAT);
+		m_BlurTextures[i].label("Blur targets", "blur" + std::to_string(i));
 		m_BlurFramebuffers[i].attach(Framebuffer::Type::READ_AND_DRAW, Framebuffer::Attachment::COLOR0, m_BlurTextures[i].handle);
 	}
 }
@@ -392,8 +673,7 @@ void Renderer::generateTexture(Texture& texture, GLint internalformat, GLenum fo
 }
 
 void Renderer::generateTexture(Texture& texture, GLint internalformat, GLenum format, GLenum type, const glm::vec2& resolution) const {
-	texture.bind(Texture::Type::TEX2D);
-	glTexImage2D(GL_TEXTURE_2D, 0, internalformat, resolution.x, resolution.y, 0, format, type, NULL);
+	texture.allocate(Texture::Type::TEX2D, internalformat, resolution.x, resolution.y, format, type);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -2,12 +2,21 @@
 
 #include "renderer/renderobject.hpp"
 #include "renderer/light.hpp"
+#include "renderer/occlusionqueries.hpp"
+#include "renderer/renderqueue.hpp"
+#include "renderer/renderstate.hpp"
 #include "renderer/scene.hpp"
+#include "renderer/skinningpalette.hpp"
+#include "renderer/uniformblocks.hpp"
+#include "renderer/visibilitylist.hpp"
 
 #include "cinematic_engine/movingcamera.hpp"
 
 #include "framework/mesh.hpp"
+#include "framework/occlusionbuffer.hpp"
+#include "framework/uniformbuffer.hpp"
 #include "framework/gl/program.hpp"
+#include "framework/gl/programvariants.hpp"
 #include "framework/gl/texture.hpp"
 #include "framework/gl/framebuffer.hpp"
 
@@ -27,36 +36,55 @@ public:
 	void update(float dt);
 	void draw();
 
-	size_t addProgram(std::shared_ptr<Program> program);
+	// instanced is the same program compiled with INSTANCED, objects sharing mesh and material are then drawn at once
+	size_t addProgram(std::shared_ptr<Program> program, std::shared_ptr<Program> instanced = nullptr);
 
 	std::shared_ptr<Scene> getScene() { return m_Scene; }
 	std::shared_ptr<Program> getProgram(size_t programId) { return m_Programs[programId]; }
 	float getExposure() const { return m_Exposure; }
 	float getGamma() const { return m_Gamma; }
 	int getBlurAmount() const { return m_BlurAmount; }
+	bool getOcclusionCulling() const { return m_OcclusionCulling; }
+	bool getOcclusionQueries() const { return m_OcclusionQueries; }
+	const RenderStats& getStats() const { return m_Stats; } // state changes of the last frame
 
 	void setScene(std::shared_ptr<Scene> scene);
 	void setExposure(float exposure) { m_Exposure = exposure; }
 	void setGamma(float gamma) { m_Gamma = gamma; }
 	void setBlurAmount(int blurAmount) { m_BlurAmount = blurAmount; }
+	void setOcclusionCulling(bool enabled) { m_OcclusionCulling = enabled; }
+	void setOcclusionQueries(bool enabled) { m_OcclusionQueries = enabled; }
 	void setResolution(const glm::vec2& resolution);
 
 	void showCameraControlPoints(bool showPoints);
 
 	void updateLightingUniforms();
 	void updateCamUniforms();
-	void updateCamUniforms(size_t programId);
 
 private:
+	// uniforms that only have to be set once, waits for the programs to finish compiling
+	void initPrograms();
+
+	void updateSkinningPalette(Scene& scene);
+	// fill m_Visibility with the tree's candidates for the next drawScene calls
+	void gatherVisibility(Scene& scene, const Frustum& frustum);
+	void gatherVisibility(Scene& scene, const glm::vec3& center, float radius);
+	// draws the occluders among the visible entries into m_Occlusion
+	void rasterizeOccluders(const std::vector<uint32_t>& visible);
 	void directionalShadowPass(Scene& scene);
 	void omnidirectionalShadowPass(Scene& scene);
 	void geometryPass(Scene& scene);
 	void lightingPass(bool enableDShadows, bool enableOShadows);
+	Program& getLightingShader(bool enableDShadows, bool enableOShadows);
 	int blurPass(int amount);
 	void hdrPass(int blurBuffer, float exposure, float gamma);
 
 	void drawScene(Scene& scene);
-	void drawScene(Scene& scene, Program& program);
+	void drawScene(Scene& scene, Program& program, Program& instanced, const Mesh::View& view, OcclusionQueries& queries);
+	// false if the entry is hidden by earlier queries of the pass, it is only drawn under conditional rendering then
+	bool submitQueried(OcclusionQueries& queries, uint32_t index);
+	// after the pass has drawn, so the boxes are tested against its depth
+	void issueQueries(OcclusionQueries& queries, const glm::mat4& toClip);
 
 	void generateTextures();
 	void generateTexture(Texture& texture, GLint internalformat, GLenum format, GLenum type) const;
@@ -69,7 +97,33 @@ private:
 	glm::vec2 m_Resolution;
 	std::shared_ptr<Scene> m_Scene;
 
+	// bound to the fixed binding points in UniformBlocks, one upload per change
+	UniformBuffer<UniformBlocks::CameraBlock> m_CameraBlock;
+	UniformBuffer<UniformBlocks::LightBlock> m_LightBlock;
+	uint64_t m_LightsVersion = 0; // Scene::getLightsVersion at the last light upload
+
 	std::vector<std::shared_ptr<Program>> m_Programs;
+	std::vector<std::shared_ptr<Program>> m_InstancedPrograms; // null if a program has no instanced variant
+	SkinningPalette m_SkinningPalette;
+	bool m_ProgramsInitialized = false;
+
+	// candidates of the current pass, drawScene only submits what its frustum contains
+	VisibilityList m_Visibility;
+	// camera pass only, shadow casters behind a house can still throw shadows into view
+	OcclusionBuffer m_Occlusion;
+	bool m_OcclusionCulling = true;
+	// expensive objects are tested on the GPU by every pass, against the depth that pass has drawn
+	OcclusionQueries m_CameraQueries;
+	OcclusionQueries m_DShadowQueries;
+	std::array<OcclusionQueries, 6> m_OShadowQueries;
+	std::vector<uint32_t> m_Queried; // entries of the current pass, see submitQueried
+	std::vector<uint32_t> m_Hidden;
+	Program m_OcclusionBoxShader;
+	Mesh m_Box;
+	bool m_OcclusionQueries = true;
+	// draws of every scene pass are sorted by state before they are issued
+	RenderQueue m_Queue;
+	RenderStats m_Stats;
 
 	Mesh m_Quad;
 
@@ -77,17 +131,25 @@ private:
 	Program m_SimpleGeometryShader;
 	std::vector<RenderObject> m_CameraControlRenderObjects;
 
+	// distant objects are replaced by impostors
+	Program m_ImpostorShader;
+
 	// directional shadow mapping
 	Texture m_DShadowMap;
 	Framebuffer m_DShadowBuffer;
 
 	Program m_DepthShader;
+	Program m_DepthShaderInstanced;
+	glm::mat4 m_LightSpaceMatrix;
 
 	// omnidirectional shadow mapping
 	Texture m_OShadowCubeMap;
 	Framebuffer m_OShadowBuffer;
 
 	Program m_CubeDepthShader;
+	Program m_CubeDepthShaderInstanced;
+	std::array<glm::mat4, 6> m_ShadowTransforms;
+	float m_OShadowFar = 25.0f; // far plane of the faces, also the range of the caster query
 
 	// deferred shading
 	Texture m_GPosition;
@@ -96,7 +158,7 @@ private:
 	Texture m_GDepth;
 	Framebuffer m_GBuffer;
 
-	Program m_LightingShader;
+	ProgramVariants m_LightingShaders; // one variant per light setup
 
 	// hdr effects
 	Texture m_ColorTexture;
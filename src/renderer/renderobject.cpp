@@ -5,50 +5,229 @@
 
 #include <iostream>
 
+// set for every draw, so their locations are resolved once per program
+static const UniformSlot U_LOCAL_TO_WORLD("uLocalToWorld");
+static const UniformSlot U_NORMAL_MATRIX("uNormalMatrix");
+static const UniformSlot U_PALETTE_OFFSET("uPaletteOffset");
+static const UniformSlot U_BONE_COUNT("uBoneCount");
+static const UniformSlot U_MATERIAL_DIFFUSE("uMaterial.diffuse");
+static const UniformSlot U_MATERIAL_SPECULAR("uMaterial.specular");
+static const UniformSlot U_CENTER("uCenter");
+static const UniformSlot U_RADIUS("uRadius");
+static const UniformSlot U_FRAME_RIGHT("uFrameRight");
+static const UniformSlot U_FRAME_UP("uFrameUp");
+static const UniformSlot U_FRAME_DIRECTION("uFrameDirection");
+static const UniformSlot U_FRAME("uFrame");
+
 RenderObject::RenderObject()
-	: m_Mesh(std::nullopt),
-	  m_AnimationModel(std::nullopt),
+	: m_Animator(nullptr),
+	  m_PaletteOffset(0),
 	  m_Position(glm::vec3(0.0f)),
 	  m_Scale(1.0f),
 	  m_Rotation(glm::angleAxis(0.0f, glm::vec3(1.0f))),
-	  m_DiffuseTexture(std::nullopt),
-	  m_NormalTexture(std::nullopt) {
+	  m_ImpostorDistance(0.0f),
+	  m_OcclusionQuery(false),
+	  m_BoundsVersion(0) {
 	setModelMatrix(glm::mat4(1.0f));
 }
 
 void RenderObject::draw(Program& program) {
-	program.bind();
-	program.set("uLocalToWorld", m_Model);
-	program.set("uNormalMatrix", m_NormalMatrix);
+	RenderState state;
+	bindUniforms(program, state);
+
+	if (Mesh* mesh = ResourceManager::tryGetMesh(m_Mesh.getHandle())) {
+		mesh->draw();
+	}
+
+	if (m_AnimationModel.isValid()) {
+		ResourceManager::getAnimationModel(m_AnimationModel).draw(program);
+	}
+}
+
+void RenderObject::draw(Program& program, const Mesh::View& view) {
+	RenderState state;
+	draw(program, view, state);
+}
+
+void RenderObject::draw(Program& program, const Mesh::View& view, RenderState& state) {
+	bindUniforms(program, state);
+
+	if (Mesh* mesh = ResourceManager::tryGetMesh(m_Mesh.getHandle())) {
+		state.changeMesh(m_Mesh.getHandle());
+		state.stats.draws++;
+
+		// transform the world space view into the local space of the mesh for meshlet culling
+		Mesh::View localView = { view.toClip * m_Model, glm::inverse(m_Model) * view.eye, view.cullFrontFaces };
+		mesh->draw(localView);
+	}
+
+	// skinned meshes deform, so their meshlet bounds don't hold
+	if (m_AnimationModel.isValid()) {
+		state.stats.draws++;
+		ResourceManager::getAnimationModel(m_AnimationModel).draw(program);
+	}
+}
+
+void RenderObject::drawInstances(Program& program, Buffer& instances, size_t first, GLsizei count, RenderState& state) {
+	// the instanced programs read the matrices from the instance attributes and ignore uLocalToWorld
+	bindUniforms(program, state);
+
+	if (Mesh* mesh = ResourceManager::tryGetMesh(m_Mesh.getHandle())) {
+		state.changeMesh(m_Mesh.getHandle());
+		state.stats.draws++;
+		state.stats.instances += count;
+
+		mesh->drawInstanced(instances, first, count);
+	}
+}
+
+void RenderObject::drawIndirect(Program& program, Buffer& instances, Buffer& commands, size_t first, GLsizei count, size_t objects, RenderState& state) {
+	bindUniforms(program, state);
+
+	if (Mesh* mesh = ResourceManager::tryGetMesh(m_Mesh.getHandle())) {
+		state.stats.draws++;
+		state.stats.instances += objects;
+
+		GeometryArena::drawIndirect(mesh->getFormat(), instances, commands, first, count);
+	}
+}
+
+void RenderObject::appendCommands(GLuint baseInstance, GLuint instanceCount, std::vector<GeometryArena::DrawCommand>& commands) const {
+	if (Mesh* mesh = ResourceManager::tryGetMesh(m_Mesh.getHandle())) {
+		mesh->appendCommands(baseInstance, instanceCount, commands);
+	}
+}
+
+void RenderObject::appendCommands(const Mesh::View& view, GLuint baseInstance, std::vector<GeometryArena::DrawCommand>& commands) const {
+	if (Mesh* mesh = ResourceManager::tryGetMesh(m_Mesh.getHandle())) {
+		Mesh::View localView = { view.toClip * m_Model, glm::inverse(m_Model) * view.eye, view.cullFrontFaces };
+		mesh->appendCommands(localView, baseInstance, commands);
+	}
+}
+
+void RenderObject::bindUniforms(Program& program, RenderState& state) {
+	state.bindProgram(program);
+	program.set(U_LOCAL_TO_WORLD, m_Model);
+	program.set(U_NORMAL_MATRIX, m_NormalMatrix);
+
+	if (m_AnimationModel.isValid()) {
+		// without an animator the rig is drawn in its bind pose
+		program.set(U_PALETTE_OFFSET, m_PaletteOffset);
+		program.set(U_BONE_COUNT, m_Animator ? static_cast<GLint>(m_Animator->getFinalBoneMatrices().size()) : 0);
+	}
+
+	// objects sharing a material are sorted next to each other, see RenderQueue
+	if (m_Material.isValid() && state.changeMaterial(m_Material)) {
+		Material& material = ResourceManager::getMaterial(m_Material);
+		program.set(U_MATERIAL_DIFFUSE, material.diffuse);
+		program.set(U_MATERIAL_SPECULAR, material.specular);
+	}
 
-	if (m_Material.has_value()) {
-		program.set("uMaterial.diffuse", ResourceManager::getMaterial(*m_Material).diffuse);
-		program.set("uMaterial.specular", ResourceManager::getMaterial(*m_Material).specular);
+	// textures that are still loading are replaced, the unit would otherwise keep the previous object's texture
+	if (m_DiffuseTexture.getHandle().isValid()) {
+		Texture* texture = ResourceManager::tryGetTexture(m_DiffuseTexture.getHandle());
+		state.bindTexture(texture ? *texture : ResourceManager::getFallbackTexture(0), 0);
 	}
 
-	if (m_DiffuseTexture.has_value()) {
-		ResourceManager::getTexture(m_DiffuseTexture.value()).bind(Texture::Type::TEX2D, 0);
+	if (m_NormalTexture.getHandle().isValid()) {
+		Texture* texture = ResourceManager::tryGetTexture(m_NormalTexture.getHandle());
+		state.bindTexture(texture ? *texture : ResourceManager::getFallbackTexture(1), 1);
 	}
+}
+
+void RenderObject::drawImpostor(Program& program, Mesh& quad, const glm::vec3& camPos) {
+	RenderState state;
+	drawImpostor(program, quad, camPos, state);
+}
+
+void RenderObject::drawImpostor(Program& program, Mesh& quad, const glm::vec3& camPos, RenderState& state) {
+	Impostor& impostor = ResourceManager::getImpostor(m_Impostor);
+
+	// select the atlas frame that was baked closest to the current view direction
+	glm::vec3 localCamPos = glm::vec3(glm::inverse(m_Model) * glm::vec4(camPos, 1.0f));
+	Impostor::Frame frame = Impostor::selectFrame(glm::normalize(localCamPos - impostor.getCenter()));
+
+	state.bindProgram(program);
+	program.set(U_LOCAL_TO_WORLD, m_Model);
+	program.set(U_NORMAL_MATRIX, m_NormalMatrix);
+	program.set(U_CENTER, impostor.getCenter());
+	program.set(U_RADIUS, impostor.getRadius());
+	program.set(U_FRAME_RIGHT, frame.right);
+	program.set(U_FRAME_UP, frame.up);
+	program.set(U_FRAME_DIRECTION, frame.direction);
+	program.set(U_FRAME, frame.index);
+
+	impostor.bind(0);
+	state.invalidateTextures();
+	state.stats.textureBinds += 3;
+	state.stats.draws++;
+
+	quad.draw();
+}
 
-	if (m_NormalTexture.has_value()) {
-		ResourceManager::getTexture(m_NormalTexture.value()).bind(Texture::Type::TEX2D, 1);
+bool RenderObject::useImpostor(const glm::vec3& camPos) const {
+	// the full mesh stands in until the atlas is baked or read from the cache
+	if (!m_Impostor.isValid() || ResourceManager::getState(m_Impostor) != AssetState::READY) {
+		return false;
 	}
 
-	if (m_Mesh.has_value()) {
-		ResourceManager::getMesh(*m_Mesh).draw();
+	return glm::distance(glm::vec3(m_Model[3]), camPos) > m_ImpostorDistance;
+}
+
+Bounds RenderObject::getBounds() const {
+	Bounds bounds;
+
+	if (Mesh* mesh = ResourceManager::tryGetMesh(m_Mesh.getHandle())) {
+		bounds.expand(mesh->getBounds());
 	}
 
-	if (m_AnimationModel.has_value()) {
-		ResourceManager::getAnimationModel(*m_AnimationModel).draw(program);
+	if (m_AnimationModel.isValid()) {
+		static const std::vector<glm::mat4> bindPose;
+		bounds.expand(ResourceManager::getAnimationModel(m_AnimationModel).getBounds(m_Animator ? m_Animator->getFinalBoneMatrices() : bindPose));
 	}
+
+	return bounds.transformed(m_Model);
+}
+
+bool RenderObject::batchesWith(const RenderObject& other) const {
+	// skinned objects read their own bone palette range
+	if (m_AnimationModel.isValid() || other.m_AnimationModel.isValid()) {
+		return false;
+	}
+
+	Mesh* mesh = ResourceManager::tryGetMesh(m_Mesh.getHandle());
+	Mesh* otherMesh = ResourceManager::tryGetMesh(other.m_Mesh.getHandle());
+
+	if (mesh == nullptr || otherMesh == nullptr || mesh->getFormat() != otherMesh->getFormat()) {
+		return false;
+	}
+
+	return m_Material == other.m_Material
+		&& m_DiffuseTexture.getHandle() == other.m_DiffuseTexture.getHandle()
+		&& m_NormalTexture.getHandle() == other.m_NormalTexture.getHandle();
 }
 
 void RenderObject::setMesh(const std::string& meshname) {
-	m_Mesh = std::make_optional<std::string>(meshname);
+	m_Mesh = ResourceManager::acquire(ResourceManager::findMesh(meshname));
+	m_BoundsVersion = nextVersion();
+}
+
+void RenderObject::setMesh(MeshHandle mesh) {
+	m_Mesh = ResourceManager::acquire(mesh);
+	m_BoundsVersion = nextVersion();
 }
 
 void RenderObject::setAnimationModel(const std::string& modelname) {
-	m_AnimationModel = std::make_optional<std::string>(modelname);
+	m_AnimationModel = ResourceManager::findAnimationModel(modelname);
+	m_BoundsVersion = nextVersion();
+}
+
+void RenderObject::setAnimator(const Animator* animator) {
+	m_Animator = animator;
+}
+
+void RenderObject::setPalette(GLint offset) {
+	m_PaletteOffset = offset;
 }
 
 void RenderObject::setPosition(const glm::vec3& position) {
@@ -78,18 +257,32 @@ void RenderObject::setRotation(const glm::quat& rotation) {
 void RenderObject::setModelMatrix(const glm::mat4& model) {
 	m_Model = model;
 	m_NormalMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
+	m_BoundsVersion = nextVersion();
 }
 
 void RenderObject::setMaterial(const std::string& material) {
-	m_Material = std::make_optional<std::string>(material);
+	m_Material = ResourceManager::findMaterial(material);
 }
 
 void RenderObject::setDiffuseTexture(const std::string& texturename) {
-	m_DiffuseTexture = std::make_optional<std::string>(texturename);
+	m_DiffuseTexture = ResourceManager::acquire(ResourceManager::findTexture(texturename));
 }
 
 void RenderObject::setNormalTexture(const std::string& texturename) {
-	m_NormalTexture = std::make_optional<std::string>(texturename);
+	m_NormalTexture = ResourceManager::acquire(ResourceManager::findTexture(texturename));
+}
+
+void RenderObject::setImpostor(const std::string& impostorname, float distance) {
+	m_Impostor = ResourceManager::findImpostor(impostorname);
+	m_ImpostorDistance = distance;
+}
+
+void RenderObject::setOccluder(const std::string& occludername) {
+	m_Occluder = ResourceManager::findOccluder(occludername);
+}
+
+void RenderObject::setOcclusionQuery(bool enabled) {
+	m_OcclusionQuery = enabled;
 }
 
 void RenderObject::recalculateModelMatrix() {
@@ -98,4 +291,9 @@ void RenderObject::recalculateModelMatrix() {
 	glm::mat4 translate = glm::translate(glm::mat4(1.0f), m_Position);
 
 	setModelMatrix(translate * rotate * scale);
+}
+
+uint64_t RenderObject::nextVersion() {
+	static uint64_t version = 0;
+	return ++version;
 }
\ No newline at end of file
@@ -2,8 +2,10 @@
 
 #include "resourcemanager.hpp"
 #include "renderer/material.hpp"
+#include "renderer/renderstate.hpp"
 #include "cinematic_engine/movingcamera.hpp"
 #include "dark_animations/animationmodel.hpp"
+#include "dark_animations/animator.hpp"
 #include "framework/mesh.hpp"
 #include "framework/gl/program.hpp"
 #include "framework/gl/texture.hpp"
@@ -14,6 +16,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 
 class RenderObject {
@@ -21,14 +24,43 @@ public:
 	RenderObject();
 
 	void draw(Program& program);
+	void draw(Program& program, const Mesh::View& view);
+	void draw(Program& program, const Mesh::View& view, RenderState& state);
+	// draws the mesh once per instance with the material and textures of this object
+	void drawInstances(Program& program, Buffer& instances, size_t first, GLsizei count, RenderState& state);
+	// draws indirect commands of objects that batch with this one, with the material and textures of this object
+	void drawIndirect(Program& program, Buffer& instances, Buffer& commands, size_t first, GLsizei count, size_t objects, RenderState& state);
+	// commands of this object for drawIndirect(), the culled variant keeps meshlet culling
+	void appendCommands(GLuint baseInstance, GLuint instanceCount, std::vector<GeometryArena::DrawCommand>& commands) const;
+	void appendCommands(const Mesh::View& view, GLuint baseInstance, std::vector<GeometryArena::DrawCommand>& commands) const;
+	void drawImpostor(Program& program, Mesh& quad, const glm::vec3& camPos);
+	void drawImpostor(Program& program, Mesh& quad, const glm::vec3& camPos, RenderState& state);
+	bool useImpostor(const glm::vec3& camPos) const;
+	// same material, textures and vertex format, so both can be drawn by one multi-draw, instancing also needs the same mesh
+	bool batchesWith(const RenderObject& other) const;
 
 	glm::mat4& getModelMatrix() { return m_Model; }
-	std::optional<std::string> getMaterial() const { return m_Material; }
-	std::optional<std::string> getDiffuseTexture() { return m_DiffuseTexture; }
-	std::optional<std::string> getNormalTexture() { return m_NormalTexture; }
+	glm::vec3 getWorldPosition() const { return glm::vec3(m_Model[3]); }
+	// world space box of the mesh and the animation model in its current pose, empty while nothing is loaded
+	Bounds getBounds() const;
+	// changes with the transform, the mesh or the animation model, see Scene::updateBounds
+	uint64_t getBoundsVersion() const { return m_BoundsVersion; }
+	MeshHandle getMesh() const { return m_Mesh.getHandle(); }
+	Mesh::Instance getInstance() const { return { m_Model, m_NormalMatrix }; }
+	MaterialHandle getMaterial() const { return m_Material; }
+	const Animator* getAnimator() const { return m_Animator; }
+	TextureHandle getDiffuseTexture() const { return m_DiffuseTexture.getHandle(); }
+	TextureHandle getNormalTexture() const { return m_NormalTexture.getHandle(); }
+	// invalid if the object hides nothing, see OcclusionBuffer
+	OccluderHandle getOccluder() const { return m_Occluder; }
+	// worth a GPU occlusion query per pass, see OcclusionQueries
+	bool hasOcclusionQuery() const { return m_OcclusionQuery; }
 
 	void setMesh(const std::string& meshname);
+	void setMesh(MeshHandle mesh);
 	void setAnimationModel(const std::string& modelname);
+	void setAnimator(const Animator* animator);
+	void setPalette(GLint offset); // set by the renderer every frame, see SkinningPalette
 	void setPosition(const glm::vec3& position);
 	void setScale(const float scale);
 	void setRotation(const float angle, const glm::vec3& axis);
@@ -37,23 +69,39 @@ public:
 	void setMaterial(const std::string& material);
 	void setDiffuseTexture(const std::string& texturename);
 	void setNormalTexture(const std::string& texturename);
+	void setImpostor(const std::string& impostorname, float distance);
+	void setOccluder(const std::string& occludername);
+	void setOcclusionQuery(bool enabled);
 
 private:
+	void bindUniforms(Program& program, RenderState& state);
 	void recalculateModelMatrix();
 
+	static uint64_t nextVersion();
+
 private:
-	std::optional<std::string> m_Mesh;
-	std::optional<std::string> m_AnimationModel;
+	MeshRef m_Mesh;
+	AnimationModelHandle m_AnimationModel;
+	const Animator* m_Animator;
+	GLint m_PaletteOffset;
 
 	glm::vec3 m_Position;
 	float m_Scale;
 	glm::quat m_Rotation;
 
-	std::optional<std::string> m_Material;
+	MaterialHandle m_Material;
+
+	TextureRef m_DiffuseTexture;
+	TextureRef m_NormalTexture;
 
-	std::optional<std::string> m_DiffuseTexture;
-	std::optional<std::string> m_NormalTexture;
+	ImpostorHandle m_Impostor;
+	float m_ImpostorDistance;
+
+	OccluderHandle m_Occluder;
+	bool m_OcclusionQuery;
 
 	glm::mat4 m_Model;
 	glm::mat3 m_NormalMatrix;
+
+	uint64_t m_BoundsVersion;
 };
\ No newline at end of file
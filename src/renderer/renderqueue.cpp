@@ -0,0 +1,184 @@
+#include "renderer/renderqueue.hpp"
+
+#include "renderer/renderobject.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+RenderQueue::RenderQueue() {
+	m_InstanceStream.label("Render queue", "instances");
+	m_CommandStream.label("Render queue", "draw commands");
+}
+
+// lowest bits of a handle index, 0 is reserved for none
+template <typename T>
+static uint64_t keyField(Handle<T> handle, int bits) {
+	return handle.isValid() ? (handle.index + 1) & ((1ull << bits) - 1) : 0;
+}
+
+uint64_t RenderQueue::makeKey(Pass pass, size_t program, const RenderObject& object, float depth) {
+	// positive floats compare like their bit patterns, the upper half keeps sign, exponent and 7 mantissa bits
+	uint32_t depthBits;
+	std::memcpy(&depthBits, &depth, sizeof(depthBits));
+	uint64_t depthKey = depth > 0.0f ? depthBits >> 16 : 0;
+
+	return (static_cast<uint64_t>(pass) & 0xF) << 60
+		| (static_cast<uint64_t>(program) & 0xFF) << 52
+		| keyField(object.getMaterial(), 8) << 44
+		| keyField(object.getDiffuseTexture(), 12) << 32
+		| keyField(object.getMesh(), 16) << 16
+		| depthKey;
+}
+
+void RenderQueue::clear() {
+	m_Packets.clear();
+}
+
+void RenderQueue::submit(Pass pass, size_t programId, Program& program, Program* instanced, RenderObject& object, float depth) {
+	m_Packets.push_back({ makeKey(pass, programId, object, depth), &object, &program, instanced, pass });
+}
+
+void RenderQueue::sort() {
+	// LSD radix sort over bytes, stable so equal keys keep their submission order
+	m_Scratch.resize(m_Packets.size());
+
+	for (int shift = 0; shift < 64; shift += 8) {
+		std::array<size_t, 256> offsets = {};
+
+		for (const Packet& packet : m_Packets) {
+			offsets[(packet.key >> shift) & 0xFF]++;
+		}
+
+		// every key has the same byte, nothing to move
+		if (offsets[(m_Packets.empty() ? 0 : m_Packets.front().key >> shift) & 0xFF] == m_Packets.size()) {
+			continue;
+		}
+
+		size_t sum = 0;
+		for (size_t& offset : offsets) {
+			size_t count = offset;
+			offset = sum;
+			sum += count;
+		}
+
+		for (const Packet& packet : m_Packets) {
+			m_Scratch[offsets[(packet.key >> shift) & 0xFF]++] = packet;
+		}
+
+		m_Packets.swap(m_Scratch);
+	}
+}
+
+void RenderQueue::buildBatches(const Mesh::View& view) {
+	const bool indirect = GeometryArena::hasMultiDrawIndirect();
+
+	m_Batches.clear();
+	m_Instances.clear();
+	m_Commands.clear();
+
+	for (size_t first = 0; first < m_Packets.size();) {
+		const Packet& packet = m_Packets[first];
+		size_t end = first + 1;
+
+		// the sort put packets with equal state next to each other, key collisions are ruled out by comparing the state
+		if (packet.pass == Pass::OPAQUE && packet.instanced != nullptr) {
+			while (end < m_Packets.size()
+				&& m_Packets[end].pass == packet.pass
+				&& m_Packets[end].program == packet.program
+				&& m_Packets[end].instanced == packet.instanced
+				&& packet.object->batchesWith(*m_Packets[end].object)
+				&& (indirect || packet.object->getMesh() == m_Packets[end].object->getMesh())) {
+				end++;
+			}
+		}
+
+		if (end - first < MIN_INSTANCES) {
+			for (size_t i = first; i < end; i++) {
+				m_Batches.push_back({ Batch::Type::SINGLE, i, 1, 0, 0 });
+			}
+		} else if (!indirect) {
+			m_Batches.push_back({ Batch::Type::INSTANCED, first, end - first, m_Instances.size(), 0 });
+
+			for (size_t i = first; i < end; i++) {
+				m_Instances.push_back(m_Packets[i].object->getInstance());
+			}
+		} else {
+			size_t firstCommand = m_Commands.size();
+
+			// runs of the same mesh become one instanced command, single objects keep their meshlet culling
+			for (size_t run = first; run < end;) {
+				size_t runEnd = run + 1;
+				while (runEnd < end && m_Packets[runEnd].object->getMesh() == m_Packets[run].object->getMesh()) {
+					runEnd++;
+				}
+
+				GLuint baseInstance = static_cast<GLuint>(m_Instances.size());
+				for (size_t i = run; i < runEnd; i++) {
+					m_Instances.push_back(m_Packets[i].object->getInstance());
+				}
+
+				if (runEnd - run >= MIN_INSTANCES) {
+					m_Packets[run].object->appendCommands(baseInstance, static_cast<GLuint>(runEnd - run), m_Commands);
+				} else {
+					m_Packets[run].object->appendCommands(view, baseInstance, m_Commands);
+				}
+
+				run = runEnd;
+			}
+
+			// everything may have been culled
+			if (m_Commands.size() > firstCommand) {
+				m_Batches.push_back({ Batch::Type::INDIRECT, first, end - first, firstCommand, m_Commands.size() - firstCommand });
+			}
+		}
+
+		first = end;
+	}
+}
+
+RenderStats RenderQueue::execute(const Mesh::View& view, const glm::vec3& camPos, Mesh& quad) {
+	RenderState state;
+
+	// all instances and commands of the pass are streamed at once before the first draw
+	buildBatches(view);
+
+	size_t instanceBase = 0, commandBase = 0;
+
+	if (!m_Instances.empty()) {
+		instanceBase = m_InstanceStream.write(m_Instances) / sizeof(Mesh::Instance);
+	}
+
+	if (!m_Commands.empty()) {
+		// base instances count from the start of the stream
+		for (GeometryArena::DrawCommand& command : m_Commands) {
+			command.baseInstance += static_cast<GLuint>(instanceBase);
+		}
+
+		commandBase = m_CommandStream.write(m_Commands) / sizeof(GeometryArena::DrawCommand);
+	}
+
+	for (const Batch& batch : m_Batches) {
+		const Packet& packet = m_Packets[batch.first];
+
+		switch (batch.type) {
+			case Batch::Type::INDIRECT:
+				packet.object->drawIndirect(*packet.instanced, m_InstanceStream.getBuffer(), m_CommandStream.getBuffer(), commandBase + batch.offset, static_cast<GLsizei>(batch.commands), batch.count, state);
+				break;
+
+			case Batch::Type::INSTANCED:
+				packet.object->drawInstances(*packet.instanced, m_InstanceStream.getBuffer(), instanceBase + batch.offset, static_cast<GLsizei>(batch.count), state);
+				break;
+
+			case Batch::Type::SINGLE:
+				if (packet.pass == Pass::IMPOSTOR) {
+					packet.object->drawImpostor(*packet.program, quad, camPos, state);
+				} else {
+					packet.object->draw(*packet.program, view, state);
+				}
+				break;
+		}
+	}
+
+	return state.stats;
+}
\ No newline at end of file
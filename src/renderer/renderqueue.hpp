@@ -0,0 +1,80 @@
+#pragma once
+
+#include "renderer/renderstate.hpp"
+#include "framework/mesh.hpp"
+#include "framework/gl/program.hpp"
+#include "framework/gl/streambuffer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class RenderObject;
+
+/**
+ * Draw packets of one pass, sorted by a 64-bit key so objects sharing state are drawn together.
+ * Key layout from the most significant bit: pass (4), program (8), material (8), texture (12), mesh (16), depth (16).
+ * Neighbors that share all state and have an instanced program are merged into one glMultiDrawElementsIndirect,
+ * without multi-draw indirect (OpenGL 4.1) only neighbors with the same mesh are merged into an instanced draw.
+ */
+class RenderQueue {
+public:
+	enum class Pass : uint8_t {
+		OPAQUE = 0,
+		IMPOSTOR = 1
+	};
+
+	struct Packet {
+		uint64_t key;
+		RenderObject* object;
+		Program* program;
+		Program* instanced; // variant that reads the matrices from instance attributes, may be null
+		Pass pass;
+	};
+
+	// smaller groups are drawn one by one and keep their meshlet culling
+	static constexpr size_t MIN_INSTANCES = 2;
+
+public:
+	RenderQueue();
+
+	static uint64_t makeKey(Pass pass, size_t program, const RenderObject& object, float depth);
+
+	void clear();
+	void submit(Pass pass, size_t programId, Program& program, Program* instanced, RenderObject& object, float depth);
+	void sort();
+	// camPos selects the impostor frames, quad is the impostor geometry
+	RenderStats execute(const Mesh::View& view, const glm::vec3& camPos, Mesh& quad);
+
+	const std::vector<Packet>& getPackets() const { return m_Packets; }
+
+private:
+	// packets drawn by one draw call
+	struct Batch {
+		enum class Type {
+			SINGLE,
+			INSTANCED,
+			INDIRECT
+		};
+
+		Type type;
+		size_t first;    // first packet
+		size_t count;    // number of packets
+		size_t offset;   // first instance or first command
+		size_t commands; // INDIRECT only
+	};
+
+	void buildBatches(const Mesh::View& view);
+
+private:
+	std::vector<Packet> m_Packets;
+	std::vector<Packet> m_Scratch; // radix sort ping-pong buffer
+
+	std::vector<Batch> m_Batches;
+	std::vector<Mesh::Instance> m_Instances;
+	StreamBuffer m_InstanceStream;
+
+	std::vector<GeometryArena::DrawCommand> m_Commands;
+	StreamBuffer m_CommandStream;
+};
\ No newline at end of file
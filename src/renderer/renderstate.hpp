@@ -0,0 +1,108 @@
+#pragma once
+
+#include "resourcemanager.hpp"
+#include "framework/gl/program.hpp"
+#include "framework/gl/texture.hpp"
+
+#include <array>
+#include <cstddef>
+
+// State changes of one frame, reported by the renderer
+struct RenderStats {
+	size_t objects = 0;     // submitted after culling, summed over all passes
+	size_t culled = 0;      // rejected by the frustum of a pass
+	size_t occluded = 0;    // inside the frustum but hidden behind occluders or by earlier occlusion queries
+	size_t queries = 0;     // occlusion queries issued
+	size_t conditional = 0; // hidden objects drawn under conditional rendering
+	size_t draws = 0;
+	size_t instances = 0; // objects drawn by instanced draws
+	size_t programBinds = 0;
+	size_t materialChanges = 0;
+	size_t textureBinds = 0;
+	size_t meshChanges = 0;
+
+	RenderStats& operator+=(const RenderStats& other);
+};
+
+/**
+ * What is currently bound while draws are issued, so binds that match the previous draw can be skipped.
+ * A default constructed state knows nothing and binds everything.
+ */
+struct RenderState {
+	Program* program = nullptr;
+	MaterialHandle material;
+	MeshHandle mesh;
+	std::array<GLuint, 2> textures = { 0, 0 }; // units 0 and 1, 0 if unknown
+
+	RenderStats stats;
+
+	void bindProgram(Program& program);
+	// true if the material uniforms have to be set
+	bool changeMaterial(MaterialHandle material);
+	void bindTexture(Texture& texture, GLuint unit);
+	void changeMesh(MeshHandle mesh);
+	// after binding textures outside of the tracked units
+	void invalidateTextures();
+};
+
+inline RenderStats& RenderStats::operator+=(const RenderStats& other) {
+	objects += other.objects;
+	culled += other.culled;
+	occluded += other.occluded;
+	queries += other.queries;
+	conditional += other.conditional;
+	draws += other.draws;
+	instances += other.instances;
+	programBinds += other.programBinds;
+	materialChanges += other.materialChanges;
+	textureBinds += other.textureBinds;
+	meshChanges += other.meshChanges;
+	return *this;
+}
+
+inline void RenderState::bindProgram(Program& program) {
+	if (this->program == &program) {
+		return;
+	}
+
+	program.bind();
+	this->program = &program;
+	stats.programBinds++;
+
+	// material uniforms belong to the program
+	material = MaterialHandle();
+}
+
+inline bool RenderState::changeMaterial(MaterialHandle material) {
+	if (this->material == material) {
+		return false;
+	}
+
+	this->material = material;
+	stats.materialChanges++;
+	return true;
+}
+
+inline void RenderState::bindTexture(Texture& texture, GLuint unit) {
+	if (unit < textures.size() && textures[unit] == texture.handle) {
+		return;
+	}
+
+	texture.bind(Texture::Type::TEX2D, unit);
+	stats.textureBinds++;
+
+	if (unit < textures.size()) {
+		textures[unit] = texture.handle;
+	}
+}
+
+inline void RenderState::changeMesh(MeshHandle mesh) {
+	if (this->mesh != mesh) {
+		this->mesh = mesh;
+		stats.meshChanges++;
+	}
+}
+
+inline void RenderState::invalidateTextures() {
+	textures.fill(0);
+}
\ No newline at end of file
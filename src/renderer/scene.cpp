@@ -2,8 +2,10 @@
 
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+
 Scene::Scene()
-	: m_RenderObjects(), m_DirLight(std::nullopt), m_PointLights(), m_CameraController(std::nullopt) {
+	: m_RenderObjects(), m_DirLight(std::nullopt), m_PointLights(), m_LightsVersion(Light::nextVersion()), m_CameraController(std::nullopt) {
 }
 
 void Scene::update(float dt) {
@@ -30,6 +32,7 @@ size_t Scene::addRenderObject(RenderObject&& renderObject, size_t programId) {
 
 void Scene::setDirLight(DirLight&& dirLight) {
 	m_DirLight = std::make_optional<DirLight>(std::move(dirLight));
+	m_LightsVersion = Light::nextVersion();
 }
 
 bool Scene::addPointLight(PointLight&& pointLight) {
@@ -38,6 +41,7 @@ bool Scene::addPointLight(PointLight&& pointLight) {
 	}
 
 	m_PointLights.push_back(pointLight);
+	m_LightsVersion = Light::nextVersion();
 
 	return true;
 }
@@ -61,6 +65,23 @@ bool Scene::removeRenderObject(size_t programId, size_t objectId) {
 
 	m_RenderObjects[programId].erase(m_RenderObjects[programId].begin() + objectId);
 
+	if (programId < m_Spatial.size() && objectId < m_Spatial[programId].size()) {
+		std::vector<Spatial>& spatial = m_Spatial[programId];
+
+		if (spatial[objectId].proxy != AABBTree::NONE) {
+			m_Tree.remove(spatial[objectId].proxy);
+		}
+
+		spatial.erase(spatial.begin() + objectId);
+
+		// the following objects moved down by one
+		for (size_t i = objectId; i < spatial.size(); i++) {
+			if (spatial[i].proxy != AABBTree::NONE) {
+				m_Tree.setUserData(spatial[i].proxy, makeKey(programId, i));
+			}
+		}
+	}
+
 	return true;
 }
 
@@ -70,6 +91,7 @@ bool Scene::removePointLight(size_t lightId) {
     }
 
     m_PointLights.erase(m_PointLights.begin() + lightId);
+    m_LightsVersion = Light::nextVersion();
 
     return true;
 }
@@ -90,6 +112,66 @@ RenderObject& Scene::getRenderObject(size_t programId, size_t objectId) {
 	return getRenderObjects(programId)[objectId];
 }
 
+uint64_t Scene::getLightsVersion() const {
+	uint64_t version = m_LightsVersion;
+
+	if (m_DirLight.has_value()) {
+		version = std::max(version, m_DirLight->getVersion());
+	}
+
+	for (const PointLight& pointLight : m_PointLights) {
+		version = std::max(version, pointLight.getVersion());
+	}
+
+	return version;
+}
+
+void Scene::updateBounds() {
+	m_Spatial.resize(m_RenderObjects.size());
+
+	for (size_t programId = 0; programId < m_RenderObjects.size(); programId++) {
+		std::vector<RenderObject>& objects = m_RenderObjects[programId];
+		std::vector<Spatial>& spatial = m_Spatial[programId];
+
+		// objects pushed directly into getRenderObjects() are picked up here as well
+		spatial.resize(objects.size());
+
+		for (size_t objectId = 0; objectId < objects.size(); objectId++) {
+			RenderObject& object = objects[objectId];
+			Spatial& entry = spatial[objectId];
+
+			// skinned bounds follow the pose, the loose tree boxes absorb most of the motion
+			bool changed = entry.version != object.getBoundsVersion() || object.getAnimator() != nullptr;
+			if (entry.proxy != AABBTree::NONE && !changed) {
+				continue;
+			}
+
+			// retried every frame until the mesh has loaded
+			Bounds bounds = object.getBounds();
+			if (!bounds.isValid()) {
+				continue;
+			}
+
+			entry.bounds = bounds;
+			entry.version = object.getBoundsVersion();
+
+			if (entry.proxy == AABBTree::NONE) {
+				entry.proxy = m_Tree.insert(bounds, makeKey(programId, objectId));
+			} else {
+				m_Tree.move(entry.proxy, bounds);
+			}
+		}
+	}
+}
+
+const AABBTree& Scene::getTree() const {
+	return m_Tree;
+}
+
+uint64_t Scene::makeKey(size_t programId, size_t objectId) {
+	return (static_cast<uint64_t>(programId) << 32) | static_cast<uint64_t>(objectId);
+}
+
 std::optional<DirLight>& Scene::getDirLight() {
 	return m_DirLight;
 }
@@ -3,17 +3,25 @@
 #include "particlesystem.hpp"
 #include "renderer/light.hpp"
 #include "renderer/renderobject.hpp"
+#include "renderer/uniformblocks.hpp"
 #include "cinematic_engine/cameracontroller.hpp"
 #include "framework/gl/program.hpp"
 #include "dark_animations/animationmodel.hpp"
+#include "framework/aabbtree.hpp"
+#include "framework/bounds.hpp"
+#include "framework/frustum.hpp"
 
+#include <glm/glm.hpp>
+
+#include <cstdint>
 #include <vector>
 #include <memory>
 #include <optional>
 
 class Scene {
 public:
-	const size_t MAX_NR_LIGHTS = 5;
+	// the light uniform block has room for this many point lights
+	static constexpr size_t MAX_NR_LIGHTS = UniformBlocks::MAX_POINT_LIGHTS;
 
 public:
 	Scene();
@@ -33,19 +41,73 @@ public:
 	std::vector<RenderObject>& getRenderObjects(size_t programId);
 	RenderObject& getRenderObject(size_t programId, size_t objectId);
 
+	// changes whenever a light is added, removed or modified, see Light::getVersion
+	uint64_t getLightsVersion() const;
+
+	// refits the bounding volume tree, objects are only revisited if their bounds version changed or they are animated
+	void updateBounds();
+	const AABBTree& getTree() const;
+
+	// callback(RenderObject&, size_t programId, const Bounds&, uint32_t proxy) for every object whose tree box overlaps,
+	// the bounds are the exact ones of the last updateBounds(), the proxy identifies the object until it is removed
+	template <typename Callback>
+	void query(const Frustum& frustum, Callback&& callback);
+	template <typename Callback>
+	void query(const glm::vec3& center, float radius, Callback&& callback);
+	template <typename Callback>
+	void raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback);
+
 	std::optional<DirLight>& getDirLight();
 	std::vector<PointLight>& getPointLights();
 	PointLight& getPointLight(size_t i);
 	std::optional<CameraController>& getCameraController();
 	std::optional<ParticleSystem>& getParticleSystem();
 
+private:
+	struct Spatial {
+		uint32_t proxy = AABBTree::NONE; // not in the tree until the object has bounds
+		uint64_t version = 0;            // RenderObject::getBoundsVersion at the last refit
+		Bounds bounds;
+	};
+
+	static uint64_t makeKey(size_t programId, size_t objectId);
+	template <typename Callback>
+	void report(uint64_t key, Callback& callback);
+
 private:
 	std::vector<std::vector<RenderObject>> m_RenderObjects;
+	std::vector<std::vector<Spatial>> m_Spatial; // parallel to m_RenderObjects
+	AABBTree m_Tree;
 
 	std::optional<DirLight> m_DirLight;
 	std::vector<PointLight> m_PointLights;
+	uint64_t m_LightsVersion; // last time lights were added or removed
 
 	std::optional<CameraController> m_CameraController;
 
 	std::optional<ParticleSystem> m_ParticleSystem;
-};
\ No newline at end of file
+};
+
+template <typename Callback>
+inline void Scene::report(uint64_t key, Callback& callback) {
+	size_t programId = static_cast<size_t>(key >> 32);
+	size_t objectId = static_cast<size_t>(key & 0xffffffff);
+
+	const Spatial& spatial = m_Spatial[programId][objectId];
+	callback(m_RenderObjects[programId][objectId], programId, spatial.bounds, spatial.proxy);
+}
+
+template <typename Callback>
+inline void Scene::query(const Frustum& frustum, Callback&& callback) {
+	m_Tree.query(frustum, [&](uint64_t key) { report(key, callback); });
+}
+
+template <typename Callback>
+inline void Scene::query(const glm::vec3& center, float radius, Callback&& callback) {
+	m_Tree.query(center, radius, [&](uint64_t key) { report(key, callback); });
+}
+
+template <typename Callback>
+inline void Scene::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) {
+	m_Tree.raycast(origin, direction, maxDistance, [&](uint64_t key) { report(key, callback); });
+}
\ No newline at end of file
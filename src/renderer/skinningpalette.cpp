@@ -0,0 +1,51 @@
+#include "renderer/skinningpalette.hpp"
+
+#include <glad/glad.h>
+
+SkinningPalette::SkinningPalette()
+	: m_TextureBuffer(0), m_Base(0) {
+	m_Stream.label("Skinning", "bone palette");
+}
+
+void SkinningPalette::clear() {
+	m_Matrices.clear();
+	m_Offsets.clear();
+}
+
+GLint SkinningPalette::add(const Animator& animator) {
+	for (const auto& [other, offset] : m_Offsets) {
+		if (other == &animator) {
+			return offset;
+		}
+	}
+
+	GLint offset = static_cast<GLint>(m_Matrices.size());
+	const std::vector<glm::mat4>& bones = animator.getFinalBoneMatrices();
+
+	m_Matrices.insert(m_Matrices.end(), bones.begin(), bones.end());
+	m_Offsets.emplace_back(&animator, offset);
+
+	return offset;
+}
+
+void SkinningPalette::upload() {
+	if (m_Matrices.empty()) {
+		return;
+	}
+
+	GLintptr offset = m_Stream.write(m_Matrices);
+	m_Base = static_cast<GLint>(offset / sizeof(glm::mat4));
+
+	// the texture views the whole ring, it only changes when the stream grows
+	if (m_Stream.getBuffer().handle != m_TextureBuffer) {
+		m_TextureBuffer = m_Stream.getBuffer().handle;
+
+		// every matrix is read as four RGBA32F texels
+		m_Texture.bind(Texture::Type::TEXTURE_BUFFER);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_TextureBuffer);
+	}
+}
+
+void SkinningPalette::bind() {
+	m_Texture.bind(Texture::Type::TEXTURE_BUFFER, TEXTURE_UNIT);
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "dark_animations/animator.hpp"
+#include "framework/gl/streambuffer.hpp"
+#include "framework/gl/texture.hpp"
+
+#include <glm/glm.hpp>
+
+#include <utility>
+#include <vector>
+
+/**
+ * Bone matrices of all animated instances in one texture buffer.
+ * Every frame the palettes are gathered with add(), uploaded at once and each instance reads its own range
+ * starting at the returned offset plus getBase(). Instances sharing an animator share a single palette.
+ */
+class SkinningPalette {
+public:
+	static constexpr GLuint TEXTURE_UNIT = 5; // uBonePalette in assimpshader.vert
+
+public:
+	SkinningPalette();
+
+	void clear();
+	// offset of the first matrix of the animator's palette, relative to getBase()
+	GLint add(const Animator& animator);
+	void upload();
+	void bind();
+
+	size_t size() const { return m_Matrices.size(); }
+	// first matrix of this frame's upload in the stream buffer
+	GLint getBase() const { return m_Base; }
+
+private:
+	std::vector<glm::mat4> m_Matrices;
+	std::vector<std::pair<const Animator*, GLint>> m_Offsets;
+
+	StreamBuffer m_Stream;
+	Texture m_Texture;
+	GLuint m_TextureBuffer; // buffer the texture currently views
+	GLint m_Base;
+};
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+/**
+ * std140 mirrors of the uniform blocks in shaders/camera.glsl and shaders/lights.glsl.
+ * vec3 members are padded to 16 bytes, the static_asserts guard the offsets the shaders expect.
+ */
+namespace UniformBlocks {
+
+// fixed binding points, assigned to every program when it is linked
+enum Binding : unsigned int {
+	CAMERA = 0,
+	LIGHTS = 1
+};
+
+constexpr size_t MAX_POINT_LIGHTS = 5; // MAX_POINT_LIGHTS in lights.glsl
+
+struct CameraBlock {
+	glm::mat4 worldToClip;
+	glm::vec3 position;
+	float padding;
+};
+
+struct DirLight {
+	glm::vec3 direction;
+	float padding0;
+	glm::vec3 color;
+	float padding1;
+};
+
+struct PointLight {
+	glm::vec3 position;
+	float padding0;
+	glm::vec3 color;
+	float radius;
+	float constant;
+	float linear;
+	float quadratic;
+	float padding1;
+};
+
+struct LightBlock {
+	DirLight dirLight;
+	PointLight pointLights[MAX_POINT_LIGHTS];
+	glm::mat4 lightSpaceMatrix;
+	glm::vec3 shadowLightPosition;
+	float far;
+};
+
+static_assert(sizeof(CameraBlock) == 80);
+static_assert(sizeof(DirLight) == 32);
+static_assert(sizeof(PointLight) == 48);
+static_assert(offsetof(LightBlock, lightSpaceMatrix) == 272);
+static_assert(sizeof(LightBlock) == 352);
+
+}
\ No newline at end of file
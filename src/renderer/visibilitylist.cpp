@@ -0,0 +1,44 @@
+#include "renderer/visibilitylist.hpp"
+
+#include "renderer/renderobject.hpp"
+
+void VisibilityList::clear() {
+	m_Entries.clear();
+	m_X.clear();
+	m_Y.clear();
+	m_Z.clear();
+	m_Radius.clear();
+}
+
+void VisibilityList::add(RenderObject& object, size_t program, const Bounds& bounds, uint32_t proxy) {
+	m_Entries.push_back({ &object, program, bounds, proxy });
+
+	glm::vec3 center = bounds.center();
+	m_X.push_back(center.x);
+	m_Y.push_back(center.y);
+	m_Z.push_back(center.z);
+	m_Radius.push_back(bounds.radius());
+}
+
+const std::vector<uint32_t>& VisibilityList::cull(const Frustum& frustum) {
+	m_Mask.resize(m_Entries.size());
+	m_Visible.clear();
+
+	frustum.intersectSpheres(m_X.data(), m_Y.data(), m_Z.data(), m_Radius.data(), m_Entries.size(), m_Mask.data());
+
+	for (size_t i = 0; i < m_Entries.size(); i++) {
+		if (!m_Mask[i]) {
+			continue;
+		}
+
+		// the sphere is loose for long objects, the box catches most of the rest
+		const Bounds& bounds = m_Entries[i].bounds;
+		if (!frustum.intersectsBox(bounds.min, bounds.max)) {
+			continue;
+		}
+
+		m_Visible.push_back(static_cast<uint32_t>(i));
+	}
+
+	return m_Visible;
+}
\ No newline at end of file
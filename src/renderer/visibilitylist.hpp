@@ -0,0 +1,42 @@
+#pragma once
+
+#include "framework/bounds.hpp"
+#include "framework/frustum.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class RenderObject;
+
+/**
+ * Candidate render objects of a pass, gathered from the scene's bounding volume tree.
+ * The bounding spheres are kept in separate coordinate arrays so the frustum can test them in batches,
+ * only the spheres that pass are refined with their box. One gather can be culled by several frustums.
+ */
+class VisibilityList {
+public:
+	struct Entry {
+		RenderObject* object;
+		size_t program;
+		Bounds bounds;
+		uint32_t proxy; // in the scene's tree, stable while other objects are removed
+	};
+
+public:
+	void clear();
+	void add(RenderObject& object, size_t program, const Bounds& bounds, uint32_t proxy);
+
+	// indices of the entries that intersect the frustum, valid until the next call
+	const std::vector<uint32_t>& cull(const Frustum& frustum);
+
+	const Entry& operator[](size_t index) const { return m_Entries[index]; }
+	size_t size() const { return m_Entries.size(); }
+
+private:
+	std::vector<Entry> m_Entries;
+
+	std::vector<float> m_X, m_Y, m_Z, m_Radius;
+	std::vector<uint8_t> m_Mask;
+	std::vector<uint32_t> m_Visible;
+};
\ No newline at end of file
@@ -1,75 +1,516 @@
 #include "resourcemanager.hpp"
 
 #include "framework/common.hpp"
+#include "framework/objparser.hpp"
+#include "framework/singleton.hpp"
 
-void ResourceManager::loadTexture(const std::string& filepath, const std::string& name) {
-	Texture texture;
-	texture.load(Texture::Format::SRGB8, Common::absolutePath(filepath), 0);
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+
+TextureHandle ResourceManager::loadTexture(const std::string& filepath, const std::string& name) {
+	std::string path = Common::absolutePath(filepath);
+	TextureHandle handle = s_Textures.reserve(name, sourceKey(path, "srgb8"));
+
+	// already loaded, or in flight on a loader thread
+	if (!s_Textures.beginLoading(handle)) {
+		waitForLoader(s_Textures, handle);
+		return handle;
+	}
+
+	try {
+		publishTexture(handle, Texture::readImage(path));
+	} catch (...) {
+		s_Textures.fail(handle);
+		throw;
+	}
+
+	return handle;
+}
+
+TextureHandle ResourceManager::loadTextureAsync(const std::string& filepath, const std::string& name) {
+	std::string path = Common::absolutePath(filepath);
+	TextureHandle handle = s_Textures.reserve(name, sourceKey(path, "srgb8"));
+
+	if (!s_Textures.beginLoading(handle)) {
+		return handle;
+	}
+
+	startLoader([handle, path]() {
+		try {
+			auto image = std::make_shared<Texture::Image>(Texture::readImage(path));
+
+			queueUpload([handle, image]() {
+				publishTexture(handle, *image);
+			});
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			s_Textures.fail(handle);
+		}
+	});
 
-	addTexture(std::move(texture), name);
+	return handle;
 }
 
-void ResourceManager::addTexture(Texture&& texture, const std::string& name) {
-	s_Textures[name] = std::move(texture);
+TextureHandle ResourceManager::addTexture(Texture&& texture, const std::string& name) {
+	texture.label("Textures", name);
+	return s_Textures.add(std::move(texture), name);
+}
+
+TextureHandle ResourceManager::findTexture(const std::string& name) {
+	TextureHandle handle = s_Textures.require(name);
+
+	// evicted textures are loaded again from their file in the background
+	if (s_Textures.getState(handle) == AssetState::EVICTED) {
+		loadTextureAsync(sourcePath(s_Textures.getSource(handle)), name);
+	}
+
+	return handle;
+}
+
+Texture& ResourceManager::getTexture(TextureHandle handle) {
+	return s_Textures.get(handle);
 }
 
 Texture& ResourceManager::getTexture(const std::string& name) {
-	return s_Textures[name];
+	TextureHandle handle = s_Textures.require(name);
+	AssetState state = s_Textures.getState(handle);
+
+	// evicted textures are loaded again, and a reload that findTexture started is waited for
+	if (state == AssetState::EVICTED) {
+		loadTexture(sourcePath(s_Textures.getSource(handle)), name);
+	} else if (state == AssetState::LOADING) {
+		waitForLoader(s_Textures, handle);
+	}
+
+	return s_Textures.get(handle);
 }
 
-void ResourceManager::loadMesh(const std::string& filepath, const std::string& name) {
-	Mesh mesh;
-	mesh.load(Common::absolutePath(filepath));
+Texture* ResourceManager::tryGetTexture(TextureHandle handle) {
+	return s_Textures.tryGet(handle);
+}
+
+TextureRef ResourceManager::acquire(TextureHandle handle) {
+	return TextureRef(s_Textures, handle);
+}
+
+namespace {
+	struct FallbackTextures {
+		Texture diffuse;
+		Texture normal;
+
+		FallbackTextures() {
+			// white, and a normal pointing up since the shaders write the sampled normal as is
+			const unsigned char white[4] = { 255, 255, 255, 255 };
+			const unsigned char up[4] = { 0, 255, 0, 255 };
 
-	addMesh(std::move(mesh), name);
+			allocate(diffuse, GL_SRGB8_ALPHA8, white);
+			allocate(normal, GL_RGBA8, up);
+
+			diffuse.label("Textures", "fallback diffuse");
+			normal.label("Textures", "fallback normal");
+		}
+
+		static void allocate(Texture& texture, GLint internalformat, const unsigned char* pixel) {
+			texture.allocate(Texture::Type::TEX2D, internalformat, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+	};
 }
 
-void ResourceManager::addMesh(Mesh&& mesh, const std::string& name) {
-	s_Meshes[name] = std::move(mesh);
+Texture& ResourceManager::getFallbackTexture(GLuint unit) {
+	FallbackTextures& fallbacks = leakedSingleton<FallbackTextures>();
+	return unit == 1 ? fallbacks.normal : fallbacks.diffuse;
+}
+
+MeshHandle ResourceManager::loadMesh(const std::string& filepath, const std::string& name) {
+	std::string path = Common::absolutePath(filepath);
+	MeshHandle handle = s_Meshes.reserve(name, sourceKey(path, "pcnt"));
+
+	// already loaded, or in flight on a loader thread
+	if (!s_Meshes.beginLoading(handle)) {
+		waitForLoader(s_Meshes, handle);
+		return handle;
+	}
+
+	try {
+		std::vector<Mesh::VertexPCNT> vertices;
+		std::vector<unsigned int> indices;
+		ObjParser::parse(path, vertices, indices);
+
+		publishMesh(handle, vertices, indices);
+	} catch (...) {
+		s_Meshes.fail(handle);
+		throw;
+	}
+
+	return handle;
+}
+
+MeshHandle ResourceManager::loadMeshAsync(const std::string& filepath, const std::string& name) {
+	std::string path = Common::absolutePath(filepath);
+	MeshHandle handle = s_Meshes.reserve(name, sourceKey(path, "pcnt"));
+
+	if (!s_Meshes.beginLoading(handle)) {
+		return handle;
+	}
+
+	startLoader([handle, path]() {
+		try {
+			auto vertices = std::make_shared<std::vector<Mesh::VertexPCNT>>();
+			auto indices = std::make_shared<std::vector<unsigned int>>();
+			ObjParser::parse(path, *vertices, *indices);
+
+			queueUpload([handle, vertices, indices]() {
+				publishMesh(handle, *vertices, *indices);
+			});
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			s_Meshes.fail(handle);
+		}
+	});
+
+	return handle;
+}
+
+MeshHandle ResourceManager::addMesh(Mesh&& mesh, const std::string& name) {
+	mesh.label(name);
+	return s_Meshes.add(std::move(mesh), name);
+}
+
+MeshHandle ResourceManager::findMesh(const std::string& name) {
+	MeshHandle handle = s_Meshes.require(name);
+
+	// evicted meshes are loaded again from their file in the background
+	if (s_Meshes.getState(handle) == AssetState::EVICTED) {
+		loadMeshAsync(sourcePath(s_Meshes.getSource(handle)), name);
+	}
+
+	return handle;
+}
+
+Mesh& ResourceManager::getMesh(MeshHandle handle) {
+	return s_Meshes.get(handle);
 }
 
 Mesh& ResourceManager::getMesh(const std::string& name) {
-	return s_Meshes[name];
+	MeshHandle handle = s_Meshes.require(name);
+	AssetState state = s_Meshes.getState(handle);
+
+	// evicted meshes are loaded again, and a reload that findMesh started is waited for
+	if (state == AssetState::EVICTED) {
+		loadMesh(sourcePath(s_Meshes.getSource(handle)), name);
+	} else if (state == AssetState::LOADING) {
+		waitForLoader(s_Meshes, handle);
+	}
+
+	return s_Meshes.get(handle);
 }
 
-void ResourceManager::loadAnimationModel(const std::string& filepath, const std::string& name) {
+Mesh* ResourceManager::tryGetMesh(MeshHandle handle) {
+	return s_Meshes.tryGet(handle);
+}
+
+MeshRef ResourceManager::acquire(MeshHandle handle) {
+	return MeshRef(s_Meshes, handle);
+}
+
+AnimationModelHandle ResourceManager::loadAnimationModel(const std::string& filepath, const std::string& name) {
 	AnimationModel model(Common::absolutePath(filepath));
 
-	addAnimationModel(std::move(model), name);
+	return addAnimationModel(std::move(model), name);
 }
 
-void ResourceManager::addAnimationModel(AnimationModel&& animationModel, const std::string& name) {
-	s_AnimationModels[name] = std::move(animationModel);
+AnimationModelHandle ResourceManager::addAnimationModel(AnimationModel&& animationModel, const std::string& name) {
+	return s_AnimationModels.add(std::move(animationModel), name);
+}
+
+AnimationModelHandle ResourceManager::findAnimationModel(const std::string& name) {
+	return s_AnimationModels.require(name);
+}
+
+AnimationModel& ResourceManager::getAnimationModel(AnimationModelHandle handle) {
+	return s_AnimationModels.get(handle);
 }
 
 AnimationModel& ResourceManager::getAnimationModel(const std::string& name) {
-	return s_AnimationModels[name];
+	return s_AnimationModels.get(name);
 }
 
-void ResourceManager::loadAnimation(const std::string& filepath, const std::string& modelname, const std::string& name) {
+AnimationHandle ResourceManager::loadAnimation(const std::string& filepath, const std::string& modelname, const std::string& name) {
 	Animation animation(Common::absolutePath(filepath), getAnimationModel(modelname));
 
-	addAnimation(std::move(animation), name);
+	return addAnimation(std::move(animation), name);
 }
 
-void ResourceManager::addAnimation(Animation&& animation, const std::string& name) {
-	s_Animations[name] = std::move(animation);
+AnimationHandle ResourceManager::addAnimation(Animation&& animation, const std::string& name) {
+	return s_Animations.add(std::move(animation), name);
+}
+
+AnimationHandle ResourceManager::findAnimation(const std::string& name) {
+	return s_Animations.require(name);
+}
+
+Animation& ResourceManager::getAnimation(AnimationHandle handle) {
+	return s_Animations.get(handle);
 }
 
 Animation& ResourceManager::getAnimation(const std::string& name) {
-	return s_Animations[name];
+	return s_Animations.get(name);
+}
+
+MaterialHandle ResourceManager::addMaterial(const Material& material, const std::string& name) {
+	return s_Materials.add(Material(material), name);
 }
 
-void ResourceManager::addMaterial(const Material& material, const std::string& name) {
-	s_Materials[name] = material;
+MaterialHandle ResourceManager::findMaterial(const std::string& name) {
+	return s_Materials.require(name);
+}
+
+Material& ResourceManager::getMaterial(MaterialHandle handle) {
+	return s_Materials.get(handle);
 }
 
 Material& ResourceManager::getMaterial(const std::string& name) {
-	return s_Materials[name];
+	return s_Materials.get(name);
+}
+
+ImpostorHandle ResourceManager::loadImpostor(const std::string& meshpath, const std::string& texturepath, const std::string& name) {
+	std::string mesh = Common::absolutePath(meshpath);
+	std::string texture = Common::absolutePath(texturepath);
+	ImpostorHandle handle = s_Impostors.reserve(name, sourceKey(mesh, "impostor:" + texture));
+
+	if (!s_Impostors.beginLoading(handle)) {
+		return handle;
+	}
+
+	// baking runs on the CPU, only the upload needs the OpenGL context
+	startLoader([handle, mesh, texture]() {
+		try {
+			auto atlas = std::make_shared<Impostor::Atlas>();
+			std::string cacheFile = Impostor::cachePath(mesh, texture);
+
+			if (!Impostor::readAtlas(cacheFile, *atlas)) {
+				std::vector<Mesh::VertexPCNT> vertices;
+				std::vector<unsigned int> indices;
+				ObjParser::parse(mesh, vertices, indices);
+
+				Texture::Image diffuse = Texture::readImage(texture);
+
+				*atlas = Impostor::bake(vertices, indices, &diffuse);
+				Impostor::writeAtlas(cacheFile, *atlas);
+			}
+
+			queueUpload([handle, atlas]() {
+				Impostor impostor;
+				impostor.load(*atlas);
+
+				s_Impostors.publish(handle, std::move(impostor));
+			});
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			s_Impostors.fail(handle);
+		}
+	});
+
+	return handle;
 }
 
-std::unordered_map<std::string, Texture> ResourceManager::s_Textures;
-std::unordered_map<std::string, Mesh> ResourceManager::s_Meshes;
-std::unordered_map<std::string, AnimationModel> ResourceManager::s_AnimationModels;
-std::unordered_map<std::string, Animation> ResourceManager::s_Animations;
-std::unordered_map<std::string, Material> ResourceManager::s_Materials;
\ No newline at end of file
+ImpostorHandle ResourceManager::addImpostor(Impostor&& impostor, const std::string& name) {
+	return s_Impostors.add(std::move(impostor), name);
+}
+
+ImpostorHandle ResourceManager::findImpostor(const std::string& name) {
+	return s_Impostors.require(name);
+}
+
+Impostor& ResourceManager::getImpostor(ImpostorHandle handle) {
+	return s_Impostors.get(handle);
+}
+
+Impostor& ResourceManager::getImpostor(const std::string& name) {
+	return s_Impostors.get(name);
+}
+
+OccluderHandle ResourceManager::loadOccluder(const std::string& meshpath, const std::string& name) {
+	std::vector<Mesh::VertexPCNT> vertices;
+	std::vector<unsigned int> indices;
+	ObjParser::parse(Common::absolutePath(meshpath), vertices, indices);
+
+	std::vector<glm::vec3> positions(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		positions[i] = vertices[i].position;
+	}
+
+	return addOccluder(Occluder::build(positions, indices), name);
+}
+
+OccluderHandle ResourceManager::addOccluder(Occluder&& occluder, const std::string& name) {
+	return s_Occluders.add(std::move(occluder), name);
+}
+
+OccluderHandle ResourceManager::findOccluder(const std::string& name) {
+	return s_Occluders.require(name);
+}
+
+Occluder& ResourceManager::getOccluder(OccluderHandle handle) {
+	return s_Occluders.get(handle);
+}
+
+Occluder& ResourceManager::getOccluder(const std::string& name) {
+	return s_Occluders.get(name);
+}
+
+AssetState ResourceManager::getState(TextureHandle handle) {
+	return s_Textures.getState(handle);
+}
+
+AssetState ResourceManager::getState(MeshHandle handle) {
+	return s_Meshes.getState(handle);
+}
+
+AssetState ResourceManager::getState(AnimationModelHandle handle) {
+	return s_AnimationModels.getState(handle);
+}
+
+AssetState ResourceManager::getState(AnimationHandle handle) {
+	return s_Animations.getState(handle);
+}
+
+AssetState ResourceManager::getState(MaterialHandle handle) {
+	return s_Materials.getState(handle);
+}
+
+AssetState ResourceManager::getState(ImpostorHandle handle) {
+	return s_Impostors.getState(handle);
+}
+
+AssetState ResourceManager::getState(OccluderHandle handle) {
+	return s_Occluders.getState(handle);
+}
+
+void ResourceManager::setMemoryBudget(const AssetSize& budget) {
+	s_Budget = budget;
+}
+
+AssetSize ResourceManager::getMemoryUsage() {
+	AssetSize meshes = s_Meshes.getUsage();
+	AssetSize textures = s_Textures.getUsage();
+
+	return { meshes.cpu + textures.cpu, meshes.gpu + textures.gpu };
+}
+
+void ResourceManager::update() {
+	processUploads();
+
+	s_Meshes.tick();
+	s_Textures.tick();
+
+	evict();
+}
+
+std::string ResourceManager::sourceKey(const std::string& path, const std::string& options) {
+	std::error_code error;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+
+	return (error ? path : canonical.string()) + "?" + options;
+}
+
+std::string ResourceManager::sourcePath(const std::string& source) {
+	return source.substr(0, source.rfind('?'));
+}
+
+void ResourceManager::publishTexture(TextureHandle handle, const Texture::Image& image) {
+	Texture texture;
+	texture.load(Texture::Format::SRGB8, image, 0);
+	texture.label("Textures", s_Textures.getName(handle));
+
+	s_Textures.publish(handle, std::move(texture), { 0, image.pixels.size() });
+}
+
+void ResourceManager::publishMesh(MeshHandle handle, const std::vector<Mesh::VertexPCNT>& vertices, const std::vector<unsigned int>& indices) {
+	Mesh mesh;
+	mesh.load(vertices, indices);
+	mesh.label(s_Meshes.getName(handle));
+
+	AssetSize size;
+	size.cpu = mesh.getMeshlets().size() * sizeof(Mesh::Meshlet);
+	size.gpu = vertices.size() * sizeof(Mesh::VertexPCNT) + indices.size() * sizeof(unsigned int);
+
+	s_Meshes.publish(handle, std::move(mesh), size);
+}
+
+void ResourceManager::processUploads() {
+	std::vector<std::function<void()>> uploads;
+
+	{
+		std::lock_guard<std::mutex> lock(s_LoaderMutex);
+		uploads.swap(s_Uploads);
+
+		// forget loaders that are done
+		s_Loaders.erase(std::remove_if(s_Loaders.begin(), s_Loaders.end(), [](const std::future<void>& loader) {
+			return loader.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		}), s_Loaders.end());
+	}
+
+	for (std::function<void()>& upload : uploads) {
+		upload();
+	}
+}
+
+template<typename T>
+void ResourceManager::waitForLoader(Registry<T>& registry, Handle<T> handle) {
+	// the upload of the loader has to run here, this is the render thread
+	while (registry.getState(handle) == AssetState::LOADING) {
+		processUploads();
+
+		std::unique_lock<std::mutex> lock(s_LoaderMutex);
+		s_LoaderProgress.wait_for(lock, std::chrono::milliseconds(10), [&]() {
+			return !s_Uploads.empty() || registry.getState(handle) != AssetState::LOADING;
+		});
+	}
+
+	if (registry.getState(handle) == AssetState::FAILED) {
+		throw std::runtime_error("Failed to load resource: " + registry.getName(handle));
+	}
+}
+
+void ResourceManager::evict() {
+	evictToBudget(s_Meshes, s_Textures, s_Budget);
+}
+
+void ResourceManager::startLoader(std::function<void()>&& loader) {
+	std::lock_guard<std::mutex> lock(s_LoaderMutex);
+	s_Loaders.push_back(std::async(std::launch::async, [loader = std::move(loader)]() {
+		loader();
+
+		// failed loaders queue no upload, waitForLoader has to see the state change
+		std::lock_guard<std::mutex> lock(s_LoaderMutex);
+		s_LoaderProgress.notify_all();
+	}));
+}
+
+void ResourceManager::queueUpload(std::function<void()>&& upload) {
+	std::lock_guard<std::mutex> lock(s_LoaderMutex);
+	s_Uploads.push_back(std::move(upload));
+	s_LoaderProgress.notify_all();
+}
+
+Registry<Texture> ResourceManager::s_Textures;
+Registry<Mesh> ResourceManager::s_Meshes;
+Registry<AnimationModel> ResourceManager::s_AnimationModels;
+Registry<Animation> ResourceManager::s_Animations;
+Registry<Material> ResourceManager::s_Materials;
+Registry<Impostor> ResourceManager::s_Impostors;
+Registry<Occluder> ResourceManager::s_Occluders;
+
+AssetSize ResourceManager::s_Budget = { SIZE_MAX, SIZE_MAX };
+
+std::mutex ResourceManager::s_LoaderMutex;
+std::condition_variable ResourceManager::s_LoaderProgress;
+std::vector<std::function<void()>> ResourceManager::s_Uploads;
+std::vector<std::future<void>> ResourceManager::s_Loaders;
\ No newline at end of file
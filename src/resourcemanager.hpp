@@ -1,41 +1,139 @@
 #pragma once
 
+#include "registry.hpp"
 #include "dark_animations/animationmodel.hpp"
 #include "dark_animations/animation.hpp"
 #include "renderer/material.hpp"
+#include "renderer/impostor.hpp"
 #include "framework/mesh.hpp"
+#include "framework/occlusionbuffer.hpp"
 #include "framework/gl/texture.hpp"
 #include "framework/gl/shader.hpp"
 
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
 
+using TextureHandle = Handle<Texture>;
+using MeshHandle = Handle<Mesh>;
+using AnimationModelHandle = Handle<AnimationModel>;
+using AnimationHandle = Handle<Animation>;
+using MaterialHandle = Handle<Material>;
+using ImpostorHandle = Handle<Impostor>;
+using OccluderHandle = Handle<Occluder>;
+
+using TextureRef = AssetRef<Texture>;
+using MeshRef = AssetRef<Mesh>;
+
+/**
+ * Global resource storage. Resources are registered under a name and referenced through handles afterwards,
+ * getX(handle) is an array access while getX(name) and findX(name) are meant for setting up scenes.
+ * Looking up a name that was never registered throws a std::runtime_error instead of creating an empty resource.
+ *
+ * The async loaders decode files on a worker thread and queue the OpenGL upload, which update()
+ * performs on the render thread. Until then the handle reports PENDING/LOADING and tryGetX returns nullptr.
+ *
+ * Textures and meshes loaded from files are deduplicated by canonical path and import options. Once they are
+ * no longer referenced by a TextureRef/MeshRef they stay cached until the memory budget is exceeded,
+ * then update() evicts them least recently used first. Looking up an evicted asset by name loads it again.
+ */
 class ResourceManager {
 public:
-	static void loadTexture(const std::string& filepath, const std::string& name);
-	static void addTexture(Texture&& texture, const std::string& name);
+	static TextureHandle loadTexture(const std::string& filepath, const std::string& name);
+	static TextureHandle loadTextureAsync(const std::string& filepath, const std::string& name);
+	static TextureHandle addTexture(Texture&& texture, const std::string& name);
+	static TextureHandle findTexture(const std::string& name);
+	static Texture& getTexture(TextureHandle handle);
 	static Texture& getTexture(const std::string& name);
+	static Texture* tryGetTexture(TextureHandle handle);
+	static TextureRef acquire(TextureHandle handle);
+	// 1x1 stand-in for a texture that is still loading on unit 0 (diffuse) or 1 (normal)
+	static Texture& getFallbackTexture(GLuint unit);
 
-	static void loadMesh(const std::string& filepath, const std::string& name);
-	static void addMesh(Mesh&& mesh, const std::string& name);
+	static MeshHandle loadMesh(const std::string& filepath, const std::string& name);
+	static MeshHandle loadMeshAsync(const std::string& filepath, const std::string& name);
+	static MeshHandle addMesh(Mesh&& mesh, const std::string& name);
+	static MeshHandle findMesh(const std::string& name);
+	static Mesh& getMesh(MeshHandle handle);
 	static Mesh& getMesh(const std::string& name);
+	static Mesh* tryGetMesh(MeshHandle handle);
+	static MeshRef acquire(MeshHandle handle);
 
-	static void loadAnimationModel(const std::string& filepath, const std::string& name);
-	static void addAnimationModel(AnimationModel&& animationModel, const std::string& name);
+	static AnimationModelHandle loadAnimationModel(const std::string& filepath, const std::string& name);
+	static AnimationModelHandle addAnimationModel(AnimationModel&& animationModel, const std::string& name);
+	static AnimationModelHandle findAnimationModel(const std::string& name);
+	static AnimationModel& getAnimationModel(AnimationModelHandle handle);
 	static AnimationModel& getAnimationModel(const std::string& name);
 
-	static void loadAnimation(const std::string& filepath, const std::string& modelname, const std::string& name);
-	static void addAnimation(Animation&& animation, const std::string& name);
+	static AnimationHandle loadAnimation(const std::string& filepath, const std::string& modelname, const std::string& name);
+	static AnimationHandle addAnimation(Animation&& animation, const std::string& name);
+	static AnimationHandle findAnimation(const std::string& name);
+	static Animation& getAnimation(AnimationHandle handle);
 	static Animation& getAnimation(const std::string& name);
 
-	static void addMaterial(const Material& material, const std::string& name);
+	static MaterialHandle addMaterial(const Material& material, const std::string& name);
+	static MaterialHandle findMaterial(const std::string& name);
+	static Material& getMaterial(MaterialHandle handle);
 	static Material& getMaterial(const std::string& name);
 
+	static ImpostorHandle loadImpostor(const std::string& meshpath, const std::string& texturepath, const std::string& name);
+	static ImpostorHandle addImpostor(Impostor&& impostor, const std::string& name);
+	static ImpostorHandle findImpostor(const std::string& name);
+	static Impostor& getImpostor(ImpostorHandle handle);
+	static Impostor& getImpostor(const std::string& name);
+
+	static OccluderHandle loadOccluder(const std::string& meshpath, const std::string& name);
+	static OccluderHandle addOccluder(Occluder&& occluder, const std::string& name);
+	static OccluderHandle findOccluder(const std::string& name);
+	static Occluder& getOccluder(OccluderHandle handle);
+	static Occluder& getOccluder(const std::string& name);
+
+	static AssetState getState(TextureHandle handle);
+	static AssetState getState(MeshHandle handle);
+	static AssetState getState(AnimationModelHandle handle);
+	static AssetState getState(AnimationHandle handle);
+	static AssetState getState(MaterialHandle handle);
+	static AssetState getState(ImpostorHandle handle);
+	static AssetState getState(OccluderHandle handle);
+
+	static void setMemoryBudget(const AssetSize& budget);
+	static AssetSize getMemoryUsage();
+
+	// call once per frame on the render thread
+	static void update();
+
 private:
-	static std::unordered_map<std::string, Texture> s_Textures;
-	static std::unordered_map<std::string, Mesh> s_Meshes;
-	static std::unordered_map<std::string, AnimationModel> s_AnimationModels;
-	static std::unordered_map<std::string, Animation> s_Animations;
-	static std::unordered_map<std::string, Material> s_Materials;
+	static std::string sourceKey(const std::string& path, const std::string& options);
+	static std::string sourcePath(const std::string& source);
+	static void publishTexture(TextureHandle handle, const Texture::Image& image);
+	static void publishMesh(MeshHandle handle, const std::vector<Mesh::VertexPCNT>& vertices, const std::vector<unsigned int>& indices);
+
+	static void processUploads();
+	// blocks while an async loader works on the asset, throws if it failed
+	template<typename T>
+	static void waitForLoader(Registry<T>& registry, Handle<T> handle);
+	static void evict();
+
+	static void startLoader(std::function<void()>&& loader);
+	static void queueUpload(std::function<void()>&& upload);
+
+private:
+	static Registry<Texture> s_Textures;
+	static Registry<Mesh> s_Meshes;
+	static Registry<AnimationModel> s_AnimationModels;
+	static Registry<Animation> s_Animations;
+	static Registry<Material> s_Materials;
+	static Registry<Impostor> s_Impostors;
+	static Registry<Occluder> s_Occluders;
+
+	static AssetSize s_Budget;
+
+	static std::mutex s_LoaderMutex;
+	static std::condition_variable s_LoaderProgress; // an upload was queued or a loader finished
+	static std::vector<std::function<void()>> s_Uploads;
+	static std::vector<std::future<void>> s_Loaders; // destroyed first, waits for running loaders
 };
\ No newline at end of file
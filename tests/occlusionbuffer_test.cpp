@@ -0,0 +1,81 @@
+#include "framework/occlusionbuffer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// With an identity worldToClip, x and y map to the screen as (x * 0.5 + 0.5) * WIDTH and depth is z * 0.5 + 0.5
+
+static float screenToX(float screen) {
+    return screen / OcclusionBuffer::WIDTH * 2.0f - 1.0f;
+}
+
+static Bounds box(const glm::vec3& min, const glm::vec3& max) {
+    Bounds bounds;
+    bounds.expand(min);
+    bounds.expand(max);
+    return bounds;
+}
+
+// quad facing the viewer from x0 to x1 over the whole height at depth z
+static Occluder wall(float x0, float x1, float z) {
+    std::vector<glm::vec3> positions = {{x0, -1.0f, z}, {x1, -1.0f, z}, {x1, 1.0f, z}, {x0, 1.0f, z}};
+    return Occluder::build(positions, {0, 1, 2, 0, 2, 3});
+}
+
+static int failures = 0;
+
+static void expect(bool condition, const char* name) {
+    std::printf("%s: %s\n", condition ? "ok  " : "FAIL", name);
+    if (!condition) failures++;
+}
+
+int main() {
+    OcclusionBuffer buffer;
+
+    // the wall ends 70% into pixel 128, a pixel center sample would count that pixel as covered
+    buffer.clear(glm::mat4(1.0f));
+    buffer.rasterize(wall(-1.0f, screenToX(128.7f), 0.0f), glm::mat4(1.0f));
+    buffer.finish();
+
+    expect(buffer.getTriangles() == 2, "both triangles are rasterized");
+    expect(!buffer.isVisible(box({-0.5f, -0.5f, 0.5f}, {-0.1f, 0.5f, 0.6f})), "box behind the wall is hidden");
+    expect(buffer.isVisible(box({-0.5f, -0.5f, -0.5f}, {-0.1f, 0.5f, -0.4f})), "box in front of the wall is visible");
+    expect(buffer.isVisible(box({0.5f, -0.5f, 0.5f}, {0.9f, 0.5f, 0.6f})), "box beside the wall is visible");
+    expect(buffer.isVisible(box({screenToX(128.75f), -0.5f, 0.5f}, {screenToX(128.95f), 0.5f, 0.6f})), "box behind a partly covered pixel is visible");
+
+    // a sloped wall stores the farthest depth of every pixel, a box right behind its surface stays visible
+    std::vector<glm::vec3> sloped = {{-1.0f, -1.0f, -0.5f}, {1.0f, -1.0f, 0.5f}, {1.0f, 1.0f, 0.5f}, {-1.0f, 1.0f, -0.5f}};
+    buffer.clear(glm::mat4(1.0f));
+    buffer.rasterize(Occluder::build(sloped, {0, 1, 2, 0, 2, 3}), glm::mat4(1.0f));
+    buffer.finish();
+
+    float x = screenToX(100.0f);
+    expect(buffer.isVisible(box({x, -0.5f, 0.5f * x + 0.0025f}, {x + 0.001f, 0.5f, 0.9f})), "box within a pixel's depth range is visible");
+    expect(!buffer.isVisible(box({-0.5f, -0.5f, 0.6f}, {0.5f, 0.5f, 0.9f})), "box behind the sloped wall is hidden");
+
+    // rough timing of a full buffer of occluders, not a pass/fail criterion
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    for (int i = 0; i < 64; i++) {
+        float x0 = -1.0f + i / 32.0f, z = i / 64.0f - 0.5f;
+        unsigned int first = static_cast<unsigned int>(positions.size());
+        positions.insert(positions.end(), {{x0, -1.0f, z}, {x0 + 0.1f, -1.0f, z}, {x0 + 0.1f, 1.0f, z}, {x0, 1.0f, z}});
+        indices.insert(indices.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+    }
+    Occluder occluder = Occluder::build(positions, indices);
+
+    const int frames = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        buffer.clear(glm::mat4(1.0f));
+        buffer.rasterize(occluder, glm::mat4(1.0f));
+        buffer.finish();
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    std::printf("%zu triangles in %.1f us per frame\n", buffer.getTriangles(), elapsed.count() / frames);
+
+    return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
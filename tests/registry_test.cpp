@@ -0,0 +1,62 @@
+#include "registry.hpp"
+
+#include <cstdio>
+#include <string>
+
+static int failures = 0;
+
+static void expect(bool condition, const char* name) {
+    std::printf("%s: %s\n", condition ? "ok  " : "FAIL", name);
+    if (!condition) failures++;
+}
+
+template<typename T>
+static Handle<T> load(Registry<T>& registry, const std::string& name, T value, const AssetSize& size) {
+    Handle<T> handle = registry.reserve(name, name + ".file");
+    registry.beginLoading(handle);
+    registry.publish(handle, std::move(value), size);
+    registry.tick();
+    return handle;
+}
+
+int main() {
+    Registry<int> meshes;
+    Registry<std::string> textures;
+
+    // loaded oldest first, each asset uses 100 bytes of GPU memory
+    Handle<int> oldMesh = load(meshes, "oldMesh", 1, {10, 100});
+    Handle<std::string> oldTexture = load(textures, "oldTexture", std::string("a"), {0, 100});
+    Handle<int> usedMesh = load(meshes, "usedMesh", 2, {10, 100});
+    Handle<std::string> newTexture = load(textures, "newTexture", std::string("b"), {0, 100});
+    Handle<int> memoryMesh = meshes.add(3, "memoryMesh");
+
+    AssetRef<int> ref(meshes, usedMesh);
+
+    evictToBudget(meshes, textures, {1000, 1000});
+    expect(meshes.getState(oldMesh) == AssetState::READY, "nothing is evicted within the budget");
+
+    evictToBudget(meshes, textures, {1000, 200});
+    expect(meshes.getState(oldMesh) == AssetState::EVICTED, "least recently used mesh is evicted");
+    expect(textures.getState(oldTexture) == AssetState::EVICTED, "least recently used texture is evicted");
+    expect(textures.getState(newTexture) == AssetState::READY, "recently used texture stays");
+    expect(meshes.getUsage().gpu + textures.getUsage().gpu == 200, "usage drops to the budget");
+
+    evictToBudget(meshes, textures, {0, 0});
+    expect(textures.getState(newTexture) == AssetState::EVICTED, "unreferenced assets are evicted down to an empty budget");
+    expect(meshes.getState(usedMesh) == AssetState::READY, "referenced mesh is never evicted");
+    expect(meshes.getState(memoryMesh) == AssetState::READY, "asset without a source is never evicted");
+
+    // evicted assets keep their name and handle and can be loaded again
+    expect(meshes.find("oldMesh") == oldMesh, "evicted asset keeps its name");
+    expect(meshes.beginLoading(oldMesh), "evicted asset can be loaded again");
+    meshes.publish(oldMesh, 1, {10, 100});
+    expect(meshes.get(oldMesh) == 1, "reloaded asset is ready");
+
+    // once the reference is dropped the asset can go as well
+    ref = AssetRef<int>();
+    evictToBudget(meshes, textures, {0, 0});
+    expect(meshes.getState(usedMesh) == AssetState::EVICTED, "released mesh is evicted");
+    expect(meshes.getUsage().gpu + textures.getUsage().gpu == 0, "all memory is released");
+
+    return failures == 0 ? 0 : 1;
+}